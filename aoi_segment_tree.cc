@@ -6,20 +6,422 @@
 //////////////////////////////////////////////////////
 
 #include <iostream>
-#include <unordered_map>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <math.h>
+#include <string.h>
 #include <node.h>
-#include "segment_tree.h"
+#include <node_object_wrap.h>
+#include <uv.h>
+#include "scene.h"
+#include "sharded_scene.h"
+#include "latency_histogram.h"
 
 using namespace v8;
+using ysd_bes_aoi::AoiId;
+using ysd_bes_aoi::LatencyHistogram;
 
-// A segment tree that maintain the x coordinate of all players.
-ysd_bes_aoi::SegmentTree x_tree;
+// Cell size of a grid scene if not given.
+const float kDefaultCellSize = 64;
 
-// A segment tree that maintain the y coordinate of all players.
-ysd_bes_aoi::SegmentTree y_tree;
+// The scene used by the module level functions.
+ysd_bes_aoi::Scene default_scene;
 
-// Store all positions with key of ID.
-std::unordered_map<uint16_t, std::pair<float, float>> positions;
+///////////////////////////////////////////////////
+// Js class of an aoi scene. Every instance owns its
+// trees and positions; the memory is given back when
+// it is closed or garbage collected.
+///////////////////////////////////////////////////
+class AoiScene final : public node::ObjectWrap
+{
+public:
+
+	// Add the AoiScene class to the exports.
+	static void Init (Local<Object> exports);
+
+	// The scene a call is made on: the AoiScene instance
+	// for methods, the default scene for module functions.
+	static ysd_bes_aoi::Scene* Get (const FunctionCallbackInfo<Value>& args)
+	{
+		Isolate* isolate = args.GetIsolate();
+		Local<FunctionTemplate> tpl = Local<FunctionTemplate>::New(isolate, tpl_);
+		if (tpl->HasInstance(args.Holder()))
+		{
+			return ObjectWrap::Unwrap<AoiScene>(args.Holder())->scene_.get();
+		}
+		return &default_scene;
+	}
+
+private:
+
+	explicit AoiScene (ysd_bes_aoi::Scene* scene) :
+		scene_ (scene)
+	{
+
+	}
+
+	// Constructor called by "new AoiScene(options)".
+	static void New (const FunctionCallbackInfo<Value>& args);
+
+	// Remove all players of the scene and give the memory back.
+	static void Close (const FunctionCallbackInfo<Value>& args);
+
+	static Persistent<FunctionTemplate> tpl_;
+
+	std::unique_ptr<ysd_bes_aoi::Scene> scene_;
+};
+
+Persistent<FunctionTemplate> AoiScene::tpl_;
+
+///////////////////////////////////////////////////
+// Js class of a scene cut into strips along x, each
+// with its own trees, see ShardedScene. Big searches
+// and batches run the strips on worker threads.
+///////////////////////////////////////////////////
+class AoiShardedScene final : public node::ObjectWrap
+{
+public:
+
+	// Add the ShardedScene class to the exports.
+	static void Init (Local<Object> exports);
+
+private:
+
+	explicit AoiShardedScene (ysd_bes_aoi::ShardedScene* scene) :
+		scene_ (scene)
+	{
+
+	}
+
+	// The scene a method is called on.
+	// @return 	Null if it is not called on a ShardedScene, an
+	//			exception is thrown then.
+	static ysd_bes_aoi::ShardedScene* Get (const FunctionCallbackInfo<Value>& args);
+
+	// Constructor called by "new ShardedScene(options)".
+	static void New (const FunctionCallbackInfo<Value>& args);
+
+	static void Insert (const FunctionCallbackInfo<Value>& args);
+	static void Remove (const FunctionCallbackInfo<Value>& args);
+	static void Update (const FunctionCallbackInfo<Value>& args);
+	static void UpdateMany (const FunctionCallbackInfo<Value>& args);
+	static void Search (const FunctionCallbackInfo<Value>& args);
+	static void SearchMany (const FunctionCallbackInfo<Value>& args);
+	static void Count (const FunctionCallbackInfo<Value>& args);
+	static void ShardSizes (const FunctionCallbackInfo<Value>& args);
+	static void Close (const FunctionCallbackInfo<Value>& args);
+
+	static Persistent<FunctionTemplate> tpl_;
+
+	std::unique_ptr<ysd_bes_aoi::ShardedScene> scene_;
+};
+
+Persistent<FunctionTemplate> AoiShardedScene::tpl_;
+
+// Latency of a kind of binding call, of all scenes: the whole
+// call, and the scene call in it. The rest of the call is the
+// checks of the arguments and making the js result.
+struct CallLatency
+{
+	LatencyHistogram call;
+	LatencyHistogram scene;
+};
+
+static CallLatency insert_latency;
+static CallLatency remove_latency;
+static CallLatency update_latency;
+static CallLatency search_latency;
+
+// Get the backing store of a typed array.
+template <typename T>
+static T* TypedArrayData (Local<TypedArray> arr)
+{
+	char* data = static_cast<char*>(arr->Buffer()->GetContents().Data());
+	return reinterpret_cast<T*>(data + arr->ByteOffset());
+}
+
+// If the value is a typed array of player ids: Uint16Array,
+// or also Uint32Array if ids are 32 bits wide.
+static bool IsIdArray (Local<Value> value)
+{
+	return value->IsUint16Array() || (sizeof(AoiId) == 4 && value->IsUint32Array());
+}
+
+// Ids widened from a Uint16Array, reused by every batch call.
+static std::vector<AoiId> wide_ids;
+
+// Get the ids of a typed array checked by IsIdArray.
+static const AoiId* IdArrayData (Local<TypedArray> arr)
+{
+	if (sizeof(AoiId) == 2 || arr->IsUint32Array())
+	{
+		return TypedArrayData<AoiId>(arr);
+	}
+	const uint16_t* ids = TypedArrayData<uint16_t>(arr);
+	wide_ids.assign(ids, ids + arr->Length());
+	return wide_ids.data();
+}
+
+// Convert a js number to a player id.
+// @return 	False with an exception thrown if the number is not a valid id.
+static bool ToId (Isolate* isolate, Local<Value> value, AoiId* id)
+{
+	double v = value->NumberValue();
+	if (!(v >= 0 && v < ysd_bes_aoi::PositionStore::kMaxIds) || v != static_cast<AoiId>(v))
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Id out of range")));
+		return false;
+	}
+	*id = static_cast<AoiId>(v);
+	return true;
+}
+
+// Create a typed array holding a copy of the ids:
+// Uint16Array or Uint32Array by the width of ids.
+static Local<TypedArray> NewIdArray (Isolate* isolate, const std::vector<AoiId>& ids)
+{
+	size_t bytes = ids.size() * sizeof(AoiId);
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, bytes);
+	std::copy(ids.begin(), ids.end(), static_cast<AoiId*>(buffer->GetContents().Data()));
+	if (sizeof(AoiId) == 2)
+	{
+		return Uint16Array::New(buffer, 0, ids.size());
+	}
+	return Uint32Array::New(buffer, 0, ids.size());
+}
+
+// Create a bitmap with one bit for each of n entities.
+static Local<Uint8Array> NewBitmap (Isolate* isolate, size_t n, uint8_t** bits)
+{
+	size_t bytes = (n + 7) >> 3;
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, bytes);
+	*bits = static_cast<uint8_t*>(buffer->GetContents().Data());
+	std::fill(*bits, *bits + bytes, 0);
+	return Uint8Array::New(buffer, 0, bytes);
+}
+
+// Create a bitmap of the results of a batch call, bit i set
+// if done[i] is not 0.
+static Local<Uint8Array> NewBitmap (Isolate* isolate, const std::vector<uint8_t>& done)
+{
+	uint8_t* bits;
+	Local<Uint8Array> result = NewBitmap(isolate, done.size(), &bits);
+	for (size_t i = 0; i < done.size(); ++i)
+	{
+		if (done[i])
+			bits[i >> 3] |= 1 << (i & 7);
+	}
+	return result;
+}
+
+// Threads the batch calls of all scenes change the y tree on
+// while the calling thread changes the x tree. None on a single
+// core. Started by the first batch call.
+static ysd_bes_aoi::WorkerPool* TreeWorkers ( )
+{
+	static ysd_bes_aoi::WorkerPool pool(std::thread::hardware_concurrency() > 1 ? 1 : 0);
+	return &pool;
+}
+
+// Results of the last batch call, reused by every one.
+static std::vector<uint8_t> batch_done;
+
+// Check the (ids, xs, ys) arguments of a batch call.
+// @return 	Number of entities in the batch, or -1 with an exception thrown.
+static int64_t CheckBatchArgs (const FunctionCallbackInfo<Value>& args, int argc)
+{
+	Isolate* isolate = args.GetIsolate();
+
+	// Check the number of argiments passed.
+	if (args.Length() != argc)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return -1;
+	}
+
+	// Check the argument types.
+	if (!IsIdArray(args[0]) || (argc == 3 && (!args[1]->IsFloat32Array() || !args[2]->IsFloat32Array())))
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return -1;
+	}
+
+	size_t n = args[0].As<TypedArray>()->Length();
+	if (argc == 3 && (args[1].As<TypedArray>()->Length() != n || args[2].As<TypedArray>()->Length() != n))
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Arrays have different lengths")));
+		return -1;
+	}
+	return n;
+}
+
+// Make a js array of player ids.
+static Local<Array> NewIdList (Isolate* isolate, const std::vector<AoiId>& ids)
+{
+	Local<Array> arr = Array::New(isolate, ids.size());
+	uint32_t index = 0;
+	for (auto id : ids)
+	{
+		arr->Set(index++, Integer::NewFromUnsigned(isolate, id));
+	}
+	return arr;
+}
+
+// Make the { offsets, ids } result of a search of many ranges.
+static Local<Object> ManyResult (Isolate* isolate, const std::vector<uint32_t>& offsets, const std::vector<AoiId>& ids)
+{
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, offsets.size() * sizeof(uint32_t));
+	std::copy(offsets.begin(), offsets.end(), static_cast<uint32_t*>(buffer->GetContents().Data()));
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "offsets"), Uint32Array::New(buffer, 0, offsets.size()));
+	result->Set(String::NewFromUtf8(isolate, "ids"), NewIdArray(isolate, ids));
+	return result;
+}
+
+///////////////////////////////////////////////////
+// Searches run on the libuv thread pool, off the js
+// thread. They search the view of the scene as it is
+// when they are started, so the scene can go on
+// changing meanwhile, and settle a promise with the
+// result back on the js thread.
+///////////////////////////////////////////////////
+class SearchJob final : public node::AsyncResource
+{
+public:
+
+	// @param[in]	view 	The players to search.
+	// @param[in]	rects 	(x_start, x_end, y_start, y_end) of every
+	//						range, copied.
+	// @param[in]	many 	If the result is { offsets, ids } as of
+	//						searchMany, else the ids of the only range.
+	SearchJob (Isolate* isolate, std::shared_ptr<const ysd_bes_aoi::SceneView<AoiId>> view,
+	           const float* rects, size_t n, bool many) :
+		node::AsyncResource (isolate, Object::New(isolate), "AoiSearch"),
+		isolate_ (isolate),
+		view_ (std::move(view)),
+		rects_ (rects, rects + 4 * n),
+		many_ (many)
+	{
+		req_.data = this;
+	}
+
+	// Queue the search. The job deletes itself when it is done.
+	// @return 	The promise of the result.
+	Local<Promise> Start ( )
+	{
+		Local<Context> context = isolate_->GetCurrentContext();
+		Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+		resolver_.Reset(isolate_, resolver);
+		if (uv_queue_work(node::GetCurrentEventLoop(isolate_), &req_, Execute, Complete) != 0)
+		{
+			resolver->Reject(context, Exception::Error(
+			                     String::NewFromUtf8(isolate_, "Can not queue the search"))).FromJust();
+			delete this;
+		}
+		return resolver->GetPromise();
+	}
+
+private:
+
+	~SearchJob ( )
+	{
+		resolver_.Reset();
+	}
+
+	// Search every range, on a thread of the pool.
+	static void Execute (uv_work_t* req)
+	{
+		SearchJob* job = static_cast<SearchJob*>(req->data);
+		size_t n = job->rects_.size() / 4;
+		std::vector<AoiId> hits;
+		job->offsets_.push_back(0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const float* r = &job->rects_[4 * i];
+			job->view_->Search(ysd_bes_aoi::Scene::BoxOf(r[0], r[1], r[2], r[3]), hits);
+			job->ids_.insert(job->ids_.end(), hits.begin(), hits.end());
+			job->offsets_.push_back(job->ids_.size());
+		}
+	}
+
+	// Settle the promise, on the js thread.
+	static void Complete (uv_work_t* req, int status)
+	{
+		SearchJob* job = static_cast<SearchJob*>(req->data);
+		Isolate* isolate = job->isolate_;
+		HandleScope handle_scope(isolate);
+
+		// Run the reactions of the promise before going back to
+		// the event loop, as a js callback would.
+		CallbackScope callback_scope(job);
+
+		Local<Context> context = isolate->GetCurrentContext();
+		Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, job->resolver_);
+		if (status != 0)
+		{
+			resolver->Reject(context, Exception::Error(
+			                     String::NewFromUtf8(isolate, "Search is cancelled"))).FromJust();
+		}
+		else if (job->many_)
+		{
+			resolver->Resolve(context, ManyResult(isolate, job->offsets_, job->ids_)).FromJust();
+		}
+		else
+		{
+			resolver->Resolve(context, NewIdArray(isolate, job->ids_)).FromJust();
+		}
+		delete job;
+	}
+
+	Isolate* isolate_;
+	uv_work_t req_;
+	Persistent<Promise::Resolver> resolver_;
+
+	// Held by the job, so a view outlives the scene changes and
+	// publishes made while it is searched.
+	std::shared_ptr<const ysd_bes_aoi::SceneView<AoiId>> view_;
+
+	std::vector<float> rects_;
+	bool many_;
+	std::vector<uint32_t> offsets_;
+	std::vector<AoiId> ids_;
+};
+
+// Check that the first argc arguments are numbers, and that
+// at most optional ones come after them.
+// @return 	False if not, an exception is thrown then.
+static bool CheckNumberArgs (const FunctionCallbackInfo<Value>& args, int argc, int optional = 0)
+{
+	Isolate* isolate = args.GetIsolate();
+
+	// Check the number of argiments passed.
+	if (args.Length() < argc || args.Length() > argc + optional)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return false;
+	}
+
+	// Check the argument types.
+	for (int i = 0; i < argc; ++i)
+	{
+		if (!args[i]->IsNumber())
+		{
+			isolate->ThrowException(Exception::TypeError(
+			                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+			return false;
+		}
+	}
+	return true;
+}
 
 // Search players in a given square range.
 // The input arguments are passed using the "args".
@@ -27,74 +429,715 @@ std::unordered_map<uint16_t, std::pair<float, float>> positions;
 // @param[in] 	args[2], args[3]	Y coordinate of the range.
 // @param[out]	args				Array of IDs of search result.
 void Search (const FunctionCallbackInfo<Value>& args)
+{
+	uint64_t call_start = LatencyHistogram::Now();
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 4)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	float x_start = args[0]->NumberValue();
+	float x_end	  = args[1]->NumberValue();
+	float y_start = args[2]->NumberValue();
+	float y_end	  = args[3]->NumberValue();
+
+	uint64_t scene_start = LatencyHistogram::Now();
+	const std::vector<AoiId>& hits = scene->Search(x_start, x_end, y_start, y_end);
+	search_latency.scene.Record(LatencyHistogram::Now() - scene_start);
+
+	args.GetReturnValue().Set(NewIdList(isolate, hits));
+	search_latency.call.Record(LatencyHistogram::Now() - call_start);
+
+}
+
+// Publish a view of the players as they are now, e.g. at the end
+// of a tick. searchPublished reads the last published view, so its
+// results stay the same whatever changes until the next publish.
+// @param[out]	args	Version of the view, counting up from 1.
+void Publish (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	args.GetReturnValue().Set(static_cast<double>(scene->Publish()));
+}
+
+// Search players in a given square range of the last published
+// view, with the same bounds as search.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	X coordinate of the range.
+// @param[in] 	args[2], args[3]	Y coordinate of the range.
+// @param[out]	args				Array of IDs of search result.
+void SearchPublished (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 4)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	std::shared_ptr<const ysd_bes_aoi::SceneView<AoiId>> view = scene->Published();
+	if (!view)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Nothing is published")));
+		return;
+	}
+
+	float x_start = args[0]->NumberValue();
+	float x_end	  = args[1]->NumberValue();
+	float y_start = args[2]->NumberValue();
+	float y_end	  = args[3]->NumberValue();
+
+	static std::vector<AoiId> hits;
+	view->Search(ysd_bes_aoi::Scene::BoxOf(x_start, x_end, y_start, y_end), hits);
+	args.GetReturnValue().Set(NewIdList(isolate, hits));
+}
+
+// Search players in a circle.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	Center of the circle.
+// @param[in] 	args[2]				Radius of the circle.
+// @param[out]	args				Array of IDs of search result, nearest first.
+void SearchRadius (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 3)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	float x_pos  = args[0]->NumberValue();
+	float y_pos  = args[1]->NumberValue();
+	float radius = args[2]->NumberValue();
+
+	args.GetReturnValue().Set(NewIdList(isolate, scene->SearchRadius(x_pos, y_pos, radius)));
+}
+
+// Search the players nearest to a position.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	The position.
+// @param[in] 	args[2]				Most players to find.
+// @param[in] 	args[3]				Optional, players farther than this are
+//									not found. No limit if not given.
+// @param[out]	args				Array of IDs of search result, nearest first.
+void Nearest (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 3 && args.Length() != 4)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber()
+	        || (args.Length() == 4 && !args[3]->IsNumber()))
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	float x_pos = args[0]->NumberValue();
+	float y_pos = args[1]->NumberValue();
+	double k = args[2]->NumberValue();
+	float max_radius = args.Length() == 4 ? args[3]->NumberValue() : INFINITY;
+	if (!(k >= 0))
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Number of players out of range")));
+		return;
+	}
+
+	// More than all players is all of them.
+	size_t n = static_cast<size_t>(std::min(k, 4294967295.0));
+	args.GetReturnValue().Set(NewIdList(isolate, scene->Nearest(x_pos, y_pos, n, max_radius)));
+}
+
+// Count players in a given square range, with the same
+// bounds as search, without making an array of them.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	X coordinate of the range.
+// @param[in] 	args[2], args[3]	Y coordinate of the range.
+// @param[in] 	args[4]				Optional, if true estimate the count in
+//									O(logn) from the players in the range
+//									on each axis instead of counting them.
+// @param[out]	args				Number of players in the range.
+void Count (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 4 && args.Length() != 5)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	float x_start = args[0]->NumberValue();
+	float x_end	  = args[1]->NumberValue();
+	float y_start = args[2]->NumberValue();
+	float y_end	  = args[3]->NumberValue();
+	bool estimate = args.Length() == 5 && args[4]->BooleanValue();
+
+	size_t count = scene->Count(x_start, x_end, y_start, y_end, !estimate);
+	args.GetReturnValue().Set(static_cast<uint32_t>(count));
+}
+
+// Search players in a given square range, writing the ids
+// into a typed array supplied by the caller instead of
+// creating a new js array.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	X coordinate of the range.
+// @param[in] 	args[2], args[3]	Y coordinate of the range.
+// @param[in] 	args[4]				Uint32Array to write the ids to, or Uint16Array
+//									if ids are 16 bits wide, so no id is cut short.
+// @param[out]	args				Number of players found. Only the first
+//									args[4].length of them are written if it is bigger.
+void SearchInto (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 5)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber()
+	        || !(args[4]->IsUint32Array() || (sizeof(AoiId) == 2 && args[4]->IsUint16Array())))
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	float x_start = args[0]->NumberValue();
+	float x_end	  = args[1]->NumberValue();
+	float y_start = args[2]->NumberValue();
+	float y_end	  = args[3]->NumberValue();
+
+	const std::vector<AoiId>& hits = scene->Search(x_start, x_end, y_start, y_end);
+
+	Local<TypedArray> out = args[4].As<TypedArray>();
+	size_t n = std::min(hits.size(), out->Length());
+	if (args[4]->IsUint16Array())
+	{
+		std::copy(hits.begin(), hits.begin() + n, TypedArrayData<uint16_t>(out));
+	}
+	else
+	{
+		std::copy(hits.begin(), hits.begin() + n, TypedArrayData<uint32_t>(out));
+	}
+
+	args.GetReturnValue().Set(static_cast<uint32_t>(hits.size()));
+}
+
+// Search players in many square ranges with one call.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Float32Array of (x1, x2, y1, y2) of every range.
+// @param[out]	args		{ offsets, ids }: the ids found in range i are
+//							ids[offsets[i]] to ids[offsets[i + 1] - 1].
+//							offsets is a Uint32Array, ids a Uint16Array or
+//							Uint32Array by the width of ids.
+void SearchMany (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 1)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsFloat32Array())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	Local<TypedArray> rects = args[0].As<TypedArray>();
+	if (rects->Length() % 4 != 0)
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Length of ranges is not a multiple of 4")));
+		return;
+	}
+
+	static std::vector<uint32_t> offsets;
+	static std::vector<AoiId> ids;
+	size_t n = rects->Length() / 4;
+	scene->SearchMany(TypedArrayData<float>(rects), n, offsets, ids);
+
+	args.GetReturnValue().Set(ManyResult(isolate, offsets, ids));
+}
+
+// Search players in a given square range off the js thread,
+// with the same bounds as search. The search sees the players
+// as they are when it is called, later changes are not seen.
+// The first async search after the players change makes a view
+// of the scene on the js thread, which copies all its leaves in
+// O(n). The ones after it, and the ones after a publish, reuse
+// that view until the players change again.
+// The input arguments are passed using the "args".
+// @param[in]	args[0], args[1]	X coordinate of the range.
+// @param[in] 	args[2], args[3]	Y coordinate of the range.
+// @param[out]	args				Promise of a Uint16Array or Uint32Array
+//									of the ids found, by the width of ids.
+void SearchAsync (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+	if (!CheckNumberArgs(args, 4))
+	{
+		return;
+	}
+
+	float rect[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rect[i] = args[i]->NumberValue();
+	}
+	SearchJob* job = new SearchJob(args.GetIsolate(), scene->View(), rect, 1, false);
+	args.GetReturnValue().Set(job->Start());
+}
+
+// Search players in many square ranges off the js thread, e.g.
+// a sweep of the whole map. The view is made or reused as by
+// searchAsync. As a view costs O(n) after every change, this
+// pays off for big sweeps, or many searches between changes:
+// use searchMany for the views of a tick.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Float32Array of (x_start, x_end, y_start, y_end)
+//							of every range, copied when it is called.
+// @param[out]	args		Promise of { offsets, ids } as of searchMany.
+void SearchManyAsync (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 1)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsFloat32Array())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	Local<TypedArray> rects = args[0].As<TypedArray>();
+	if (rects->Length() % 4 != 0)
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Length of ranges is not a multiple of 4")));
+		return;
+	}
+
+	SearchJob* job = new SearchJob(isolate, scene->View(), TypedArrayData<float>(rects), rects->Length() / 4, true);
+	args.GetReturnValue().Set(job->Start());
+}
+
+// Add a new player to the game scene.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		The id of the new player.
+// @param[in]	args[1] 	The x coordinate of the player's position.
+// @param[in]	args[2] 	The y coordinate of the player's position.
+// @param[out]	args		If the insert is successful?
+void Insert (const FunctionCallbackInfo<Value>& args)
+{
+	uint64_t call_start = LatencyHistogram::Now();
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 3)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	AoiId id;
+	if (!ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+	float x_pos = args[1]->NumberValue();
+	float y_pos = args[2]->NumberValue();
+
+	uint64_t scene_start = LatencyHistogram::Now();
+	bool inserted = scene->Insert(id, x_pos, y_pos);
+	insert_latency.scene.Record(LatencyHistogram::Now() - scene_start);
+
+	args.GetReturnValue().Set(inserted);
+	insert_latency.call.Record(LatencyHistogram::Now() - call_start);
+}
+
+// Remove a player from the game scene.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		The id of the removed player.
+// @param[out]	args		If the remove is successful?
+void Remove (const FunctionCallbackInfo<Value>& args)
+{
+	uint64_t call_start = LatencyHistogram::Now();
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 1)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	AoiId id;
+	if (!ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+
+	uint64_t scene_start = LatencyHistogram::Now();
+	bool removed = scene->Remove(id);
+	remove_latency.scene.Record(LatencyHistogram::Now() - scene_start);
+
+	args.GetReturnValue().Set(removed);
+	remove_latency.call.Record(LatencyHistogram::Now() - call_start);
+}
+
+// Update a player's position.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		The id of the moved player.
+// @param[in]	args[1] 	The x coordinate of the player's position.
+// @param[in]	args[2] 	The y coordinate of the player's position.
+// @param[out]	args		If the remove is successful?
+void Update (const FunctionCallbackInfo<Value>& args)
+{
+	uint64_t call_start = LatencyHistogram::Now();
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	// Check the number of argiments passed.
+	if (args.Length() != 3)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	AoiId id;
+	if (!ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+	float new_x_pos = args[1]->NumberValue();
+	float new_y_pos = args[2]->NumberValue();
+
+	uint64_t scene_start = LatencyHistogram::Now();
+	bool updated = scene->Update(id, new_x_pos, new_y_pos);
+	update_latency.scene.Record(LatencyHistogram::Now() - scene_start);
+
+	args.GetReturnValue().Set(updated);
+	update_latency.call.Record(LatencyHistogram::Now() - call_start);
+
+}
+
+// Add many players in one call.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Uint16Array or Uint32Array of ids of the new players.
+// @param[in]	args[1] 	Float32Array of x coordinates.
+// @param[in]	args[2] 	Float32Array of y coordinates.
+// @param[out]	args		Uint8Array bitmap, bit i is set if the i-th insert is successful.
+void InsertMany (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+	int64_t n = CheckBatchArgs(args, 3);
+	if (n < 0)
+	{
+		return;
+	}
+
+	const AoiId* ids = IdArrayData(args[0].As<TypedArray>());
+	const float* xs = TypedArrayData<float>(args[1].As<TypedArray>());
+	const float* ys = TypedArrayData<float>(args[2].As<TypedArray>());
+	scene->InsertMany(ids, xs, ys, n, batch_done, TreeWorkers());
+
+	args.GetReturnValue().Set(NewBitmap(args.GetIsolate(), batch_done));
+}
+
+// Remove many players in one call.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Uint16Array or Uint32Array of ids of the removed players.
+// @param[out]	args		Uint8Array bitmap, bit i is set if the i-th remove is successful.
+void RemoveMany (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+	int64_t n = CheckBatchArgs(args, 1);
+	if (n < 0)
+	{
+		return;
+	}
+
+	const AoiId* ids = IdArrayData(args[0].As<TypedArray>());
+	scene->RemoveMany(ids, n, batch_done, TreeWorkers());
+
+	args.GetReturnValue().Set(NewBitmap(args.GetIsolate(), batch_done));
+}
+
+// Move many players in one call, e.g. all the moves of a tick.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Uint16Array or Uint32Array of ids of the moved players.
+// @param[in]	args[1] 	Float32Array of new x coordinates.
+// @param[in]	args[2] 	Float32Array of new y coordinates.
+// @param[out]	args		Uint8Array bitmap, bit i is set if the i-th update is successful.
+void UpdateMany (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+	int64_t n = CheckBatchArgs(args, 3);
+	if (n < 0)
+	{
+		return;
+	}
+
+	const AoiId* ids = IdArrayData(args[0].As<TypedArray>());
+	const float* xs = TypedArrayData<float>(args[1].As<TypedArray>());
+	const float* ys = TypedArrayData<float>(args[2].As<TypedArray>());
+	scene->UpdateMany(ids, xs, ys, n, batch_done, TreeWorkers());
+
+	args.GetReturnValue().Set(NewBitmap(args.GetIsolate(), batch_done));
+}
+
+// Replace all players of the scene at once, e.g. at map load.
+// Both trees are built bottom up from sorted data, which is
+// much faster than inserting the players one by one.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Uint16Array or Uint32Array of ids of the players.
+// @param[in]	args[1] 	Float32Array of x coordinates.
+// @param[in]	args[2] 	Float32Array of y coordinates.
+void Load (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	int64_t n = CheckBatchArgs(args, 3);
+	if (n < 0)
+	{
+		return;
+	}
+
+	const AoiId* ids = IdArrayData(args[0].As<TypedArray>());
+	const float* xs = TypedArrayData<float>(args[1].As<TypedArray>());
+	const float* ys = TypedArrayData<float>(args[2].As<TypedArray>());
+
+	if (!scene->Load(ids, xs, ys, n, TreeWorkers()))
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Duplicate ids or id out of range")));
+		return;
+	}
+}
+
+// Get the file path argument of save and restore.
+// @return 	False if it is not a string, an exception is thrown then.
+static bool ToPath (const FunctionCallbackInfo<Value>& args, std::string* path)
+{
+	Isolate* isolate = args.GetIsolate();
+
+	// Check the number of argiments passed.
+	if (args.Length() != 1)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return false;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsString())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return false;
+	}
+
+	String::Utf8Value utf8(isolate, args[0]);
+	path->assign(*utf8, utf8.length());
+	return true;
+}
+
+// Write all players of the scene to a snapshot file.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Path of the file. It is replaced at once
+//							when the new one is fully written.
+void Save (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+
+	std::string path;
+	if (!ToPath(args, &path))
+	{
+		return;
+	}
+
+	if (!scene->Save(path.c_str()))
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Can not write snapshot")));
+		return;
+	}
+}
+
+// Replace all players of the scene with the ones of a snapshot
+// file. The trees are built from the sorted leaves in the file,
+// without inserting the players one by one. Watch ranges are
+// dropped, as by load.
+// The input arguments are passed using the "args".
+// @param[in]	args[0]		Path of the file.
+void Restore (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
-	// Check the number of argiments passed.
-	if (args.Length() != 4)
+	std::string path;
+	if (!ToPath(args, &path))
 	{
-		isolate->ThrowException(Exception::Error(
-		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
 		return;
 	}
 
-	// Check the argument types.
-	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber())
+	if (!scene->Restore(path.c_str()))
 	{
-		isolate->ThrowException(Exception::TypeError(
-		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Can not read snapshot or it is not valid")));
 		return;
 	}
+}
 
-	float x_start = args[0]->NumberValue();
-	float x_end	  = args[1]->NumberValue();
-	float y_start = args[2]->NumberValue();
-	float y_end	  = args[3]->NumberValue();
+// Check the square range of the hole aoi.
+void CheckRange (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
-	float x_len = x_end - x_start;
-	float y_len = y_end - y_start;
-	std::vector<uint16_t> result;
+	float x1, x2, y1, y2;
 	Local<Array> arr = Array::New(isolate);
-	uint32_t index = 0;
 
-	if (x_len < y_len)
-	{
-		// Search at x tree.
-		x_tree.Search(x_start, x_end, result);
-		for (auto id : result)
-		{
-			const std::pair<float, float>& position = positions[id];
-			if (position.second < y_end && position.second > y_start)
-				arr->Set(index++, Integer::New(isolate, id));
-		}
-	}
-	else
+	if (scene->Range(&x1, &x2, &y1, &y2))
 	{
-		// Search at y tree.
-		y_tree.Search(y_start, y_end, result);
-		for (auto id : result)
-		{
-			const std::pair<float, float>& position = positions[id];
-			if (position.first < x_end && position.first > x_start)
-				arr->Set(index++, Integer::New(isolate, id));
-		}
+		arr->Set(0, Number::New(isolate, x1));
+		arr->Set(1, Number::New(isolate, x2));
+		arr->Set(2, Number::New(isolate, y1));
+		arr->Set(3, Number::New(isolate, y2));
 	}
 
 	args.GetReturnValue().Set(arr);
 
 }
 
-// Add a new player to the game scene.
+// Set the watch range of a subscriber, e.g. the view range of a player.
 // The input arguments are passed using the "args".
-// @param[in]	args[0]		The id of the new player.
-// @param[in]	args[1] 	The x coordinate of the player's position.
-// @param[in]	args[2] 	The y coordinate of the player's position.
-void Insert (const FunctionCallbackInfo<Value>& args)
+// @param[in]	args[0]				Id of the subscriber.
+// @param[in]	args[1], args[2]	X coordinate of the range.
+// @param[in] 	args[3], args[4]	Y coordinate of the range.
+void Watch (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
 	// Check the number of argiments passed.
-	if (args.Length() != 3)
+	if (args.Length() != 5)
 	{
 		isolate->ThrowException(Exception::Error(
 		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
@@ -102,29 +1145,31 @@ void Insert (const FunctionCallbackInfo<Value>& args)
 	}
 
 	// Check the argument types.
-	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber())
+	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber() || !args[3]->IsNumber() || !args[4]->IsNumber())
 	{
 		isolate->ThrowException(Exception::TypeError(
 		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
 		return;
 	}
 
-	uint16_t id = args[0]->NumberValue();
-	float x_pos = args[1]->NumberValue();
-	float y_pos = args[2]->NumberValue();
+	AoiId subscriber;
+	if (!ToId(isolate, args[0], &subscriber))
+	{
+		return;
+	}
 
-	positions[id] = std::make_pair(x_pos, y_pos);
-	x_tree.Insert(id, x_pos);
-	y_tree.Insert(id, y_pos);
+	scene->Watch(subscriber, args[1]->NumberValue(), args[2]->NumberValue(),
+	             args[3]->NumberValue(), args[4]->NumberValue());
 }
 
-// Remove a player from the game scene.
+// Remove a subscriber.
 // The input arguments are passed using the "args".
-// @param[in]	args[0]		The id of the removed player.
-// @param[out]	args		If the remove is successful?
-void Remove (const FunctionCallbackInfo<Value>& args)
+// @param[in]	args[0]		Id of the subscriber.
+// @param[out]	args		If it was a subscriber?
+void Unwatch (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
 	// Check the number of argiments passed.
 	if (args.Length() != 1)
@@ -142,75 +1187,152 @@ void Remove (const FunctionCallbackInfo<Value>& args)
 		return;
 	}
 
-	uint16_t id = args[0]->NumberValue();
-	float x_pos = positions[id].first;
-	float y_pos = positions[id].second;
-
-	bool v = x_tree.Remove(id, x_pos) && y_tree.Remove(id, y_pos);
-	positions.erase(id);
+	AoiId subscriber;
+	if (!ToId(isolate, args[0], &subscriber))
+	{
+		return;
+	}
 
-	args.GetReturnValue().Set(v);
+	args.GetReturnValue().Set(scene->Unwatch(subscriber));
 }
 
-// Update a player's position.
-// The input arguments are passed using the "args".
-// @param[in]	args[0]		The id of the moved player.
-// @param[in]	args[1] 	The x coordinate of the player's position.
-// @param[in]	args[2] 	The y coordinate of the player's position.
-// @param[out]	args		If the remove is successful?
-void Update (const FunctionCallbackInfo<Value>& args)
+// Get the players which entered or left the range of every
+// subscriber since the last call. Call it once per tick,
+// after the moves and watch ranges are updated.
+// @param[out]	args	{ enter, leave }, each a typed array of
+//						flattened (subscriber, player) pairs.
+void Events (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
-	// Check the number of argiments passed.
-	if (args.Length() != 3)
-	{
-		isolate->ThrowException(Exception::Error(
-		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
-		return;
-	}
+	static std::vector<AoiId> enter;
+	static std::vector<AoiId> leave;
+	scene->Events(enter, leave);
 
-	// Check the argument types.
-	if (!args[0]->IsNumber() || !args[1]->IsNumber() || !args[2]->IsNumber())
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "enter"), NewIdArray(isolate, enter));
+	result->Set(String::NewFromUtf8(isolate, "leave"), NewIdArray(isolate, leave));
+	args.GetReturnValue().Set(result);
+}
+
+// Make a js object of the counters of a tree.
+static Local<Object> StatsObject (Isolate* isolate, const ysd_bes_aoi::TreeStats& stats)
+{
+	Local<Object> obj = Object::New(isolate);
+	auto set = [&] (const char* name, double value)
 	{
-		isolate->ThrowException(Exception::TypeError(
-		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
-		return;
-	}
+		obj->Set(String::NewFromUtf8(isolate, name), Number::New(isolate, value));
+	};
+	set("updateInPlace", stats.update_in_place);
+	set("updateShifted", stats.update_shifted);
+	set("updateReinserted", stats.update_reinserted);
+	set("searchWalks", stats.search_walks);
+	set("searchFlat", stats.search_flat);
+	set("nodesVisited", stats.nodes_visited);
+	set("rotationsR", stats.rotations_r);
+	set("rotationsL", stats.rotations_l);
+	set("rotationsRL", stats.rotations_rl);
+	set("rotationsLR", stats.rotations_lr);
+	set("height", stats.height);
+	set("idealHeight", stats.ideal_height);
+	set("leaves", stats.leaves);
+	set("nodes", stats.nodes);
+	set("bytes", stats.bytes);
+	return obj;
+}
 
-	uint16_t id = args[0]->NumberValue();
-	float cur_x_pos = positions[id].first;
-	float cur_y_pos = positions[id].second;
-	float new_x_pos = args[1]->NumberValue();
-	float new_y_pos = args[2]->NumberValue();
+// Get the counters and the health of the trees.
+// @param[out]	args	{ counting, x, y }. counting tells if the
+//						addon is built with -Daoi_stats=1, else the
+//						search and rotation counters stay 0. x and y
+//						are the counters of the x and y tree:
+//						update*: number of updates by the path they took.
+//						searchWalks, searchFlat, nodesVisited: searches
+//						by tree walk or flat layout, nodes the walks visited.
+//						rotations*: rotations by kind.
+//						height, idealHeight: height of the tree, and of
+//						a perfect tree with as many leaves.
+//						leaves, nodes, bytes: players, nodes in use and
+//						memory of the tree.
+void Stats (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
-	bool v = x_tree.Update(id, cur_x_pos, new_x_pos) && y_tree.Update(id, cur_y_pos, new_y_pos);
+	ysd_bes_aoi::TreeStats x_stats, y_stats;
+	scene->Stats(&x_stats, &y_stats);
 
-	positions[id].first = new_x_pos;
-	positions[id].second = new_y_pos;
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "counting"), Boolean::New(isolate, AOI_STATS != 0));
+	result->Set(String::NewFromUtf8(isolate, "x"), StatsObject(isolate, x_stats));
+	result->Set(String::NewFromUtf8(isolate, "y"), StatsObject(isolate, y_stats));
+	args.GetReturnValue().Set(result);
+}
 
-	args.GetReturnValue().Set(v);
+// Make a js object of a latency histogram, in nanoseconds.
+static Local<Object> LatencyObject (Isolate* isolate, const LatencyHistogram& histogram)
+{
+	Local<Object> obj = Object::New(isolate);
+	auto set = [&] (const char* name, double value)
+	{
+		obj->Set(String::NewFromUtf8(isolate, name), Number::New(isolate, value));
+	};
+	uint64_t count = histogram.count();
+	set("count", count);
+	set("mean", count == 0 ? 0 : static_cast<double>(histogram.sum()) / count);
+	set("p50", histogram.Percentile(0.50));
+	set("p90", histogram.Percentile(0.90));
+	set("p99", histogram.Percentile(0.99));
+	set("p999", histogram.Percentile(0.999));
+	set("max", histogram.max());
+	return obj;
+}
 
+static Local<Object> CallLatencyObject (Isolate* isolate, const CallLatency& latency)
+{
+	Local<Object> obj = Object::New(isolate);
+	obj->Set(String::NewFromUtf8(isolate, "call"), LatencyObject(isolate, latency.call));
+	obj->Set(String::NewFromUtf8(isolate, "scene"), LatencyObject(isolate, latency.scene));
+	return obj;
 }
 
-// Check the square range of the hole aoi.
-void CheckRange (const FunctionCallbackInfo<Value>& args)
+// Get the latency of the insert, remove, update and search
+// calls of all scenes since the last resetLatency().
+// @param[out]	args	{ insert, remove, update, search }, each of
+//						{ call, scene }: the whole call, and the scene
+//						call in it, without the checks of the arguments
+//						and making the js result. Each is { count, mean,
+//						p50, p90, p99, p999, max } in nanoseconds.
+void LatencyReport (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
 
-	float x1, x2, y1, y2;
-	Local<Array> arr = Array::New(isolate);
+	Local<Object> result = Object::New(isolate);
+	result->Set(String::NewFromUtf8(isolate, "insert"), CallLatencyObject(isolate, insert_latency));
+	result->Set(String::NewFromUtf8(isolate, "remove"), CallLatencyObject(isolate, remove_latency));
+	result->Set(String::NewFromUtf8(isolate, "update"), CallLatencyObject(isolate, update_latency));
+	result->Set(String::NewFromUtf8(isolate, "search"), CallLatencyObject(isolate, search_latency));
+	args.GetReturnValue().Set(result);
+}
 
-	if (x_tree.Range(&x1, &x2) && y_tree.Range(&y1, &y2))
+// Forget the latency counted so far.
+void ResetLatency (const FunctionCallbackInfo<Value>& args)
+{
+	for (CallLatency* latency : {&insert_latency, &remove_latency, &update_latency, &search_latency})
 	{
-		arr->Set(0, Number::New(isolate, x1));
-		arr->Set(1, Number::New(isolate, x2));
-		arr->Set(2, Number::New(isolate, y1));
-		arr->Set(3, Number::New(isolate, y2));
+		latency->call.Reset();
+		latency->scene.Reset();
 	}
+}
 
-	args.GetReturnValue().Set(arr);
-
+// Rebuild the flat search layout of both trees now.
+// Call it between ticks, after all moves are applied, so
+// the searches of the next tick do not have to walk the trees.
+void Flatten (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
+	scene->Flatten();
 }
 
 // Print the segment trees by layer.
@@ -220,6 +1342,7 @@ void CheckRange (const FunctionCallbackInfo<Value>& args)
 void Print (const FunctionCallbackInfo<Value>& args)
 {
 	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::Scene* scene = AoiScene::Get(args);
 
 	if (args.Length() > 2)
 	{
@@ -228,8 +1351,7 @@ void Print (const FunctionCallbackInfo<Value>& args)
 	// Check the argument types.
 	if (args.Length() == 0)
 	{
-		x_tree.Print();
-		y_tree.Print();
+		scene->Print(true, true);
 	}
 	else if (args.Length() == 1)
 	{
@@ -239,8 +1361,7 @@ void Print (const FunctionCallbackInfo<Value>& args)
 			                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
 			return;
 		}
-		if (args[0]->BooleanValue())
-			x_tree.Print();
+		scene->Print(args[0]->BooleanValue(), false);
 	}
 	else if (args.Length() == 2)
 	{
@@ -250,10 +1371,7 @@ void Print (const FunctionCallbackInfo<Value>& args)
 			                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
 			return;
 		}
-		if (args[0]->BooleanValue())
-			x_tree.Print();
-		if (args[1]->BooleanValue())
-			y_tree.Print();
+		scene->Print(args[0]->BooleanValue(), args[1]->BooleanValue());
 	}
 	else
 	{
@@ -263,14 +1381,387 @@ void Print (const FunctionCallbackInfo<Value>& args)
 	}
 }
 
+void AoiScene::New (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+
+	if (!args.IsConstructCall())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Use the new operator to create an AoiScene")));
+		return;
+	}
+
+	// Options: { backend: "tree" | "grid", cellSize: number }
+	ysd_bes_aoi::Scene* scene = nullptr;
+	if (args.Length() == 0 || args[0]->IsUndefined())
+	{
+		scene = new ysd_bes_aoi::Scene();
+	}
+	else if (args[0]->IsObject())
+	{
+		Local<Object> options = args[0]->ToObject();
+		Local<Value> backend = options->Get(String::NewFromUtf8(isolate, "backend"));
+		Local<Value> cell_size = options->Get(String::NewFromUtf8(isolate, "cellSize"));
+		String::Utf8Value name(isolate, backend);
+
+		if (backend->IsUndefined() || (backend->IsString() && strcmp(*name, "tree") == 0))
+		{
+			scene = new ysd_bes_aoi::Scene();
+		}
+		else if (backend->IsString() && strcmp(*name, "grid") == 0)
+		{
+			float size = cell_size->IsUndefined() ? kDefaultCellSize : cell_size->NumberValue();
+			if (size > 0)
+			{
+				scene = new ysd_bes_aoi::Scene(size);
+			}
+		}
+	}
+
+	if (scene == nullptr)
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong options of AoiScene")));
+		return;
+	}
+
+	AoiScene* obj = new AoiScene(scene);
+	obj->Wrap(args.This());
+	args.GetReturnValue().Set(args.This());
+}
+
+void AoiScene::Close (const FunctionCallbackInfo<Value>& args)
+{
+	AoiScene::Get(args)->Close();
+}
+
+void AoiScene::Init (Local<Object> exports)
+{
+	Isolate* isolate = exports->GetIsolate();
+
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+	tpl->SetClassName(String::NewFromUtf8(isolate, "AoiScene"));
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+	NODE_SET_PROTOTYPE_METHOD(tpl, "insert", Insert);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "remove", Remove);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "search", Search);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchInto", SearchInto);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchMany", SearchMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchAsync", SearchAsync);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchManyAsync", SearchManyAsync);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "count", Count);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "publish", Publish);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchPublished", SearchPublished);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchRadius", SearchRadius);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "nearest", Nearest);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "update", Update);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "insertMany", InsertMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "removeMany", RemoveMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "updateMany", UpdateMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "load", Load);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "save", Save);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "restore", Restore);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "range",  CheckRange);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "flatten", Flatten);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "watch", Watch);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "unwatch", Unwatch);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "events", Events);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "stats", Stats);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "print",  Print);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "close",  Close);
+
+	tpl_.Reset(isolate, tpl);
+	exports->Set(String::NewFromUtf8(isolate, "AoiScene"), tpl->GetFunction());
+}
+
+ysd_bes_aoi::ShardedScene* AoiShardedScene::Get (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	Local<FunctionTemplate> tpl = Local<FunctionTemplate>::New(isolate, tpl_);
+	if (!tpl->HasInstance(args.Holder()))
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Not a ShardedScene")));
+		return nullptr;
+	}
+	return ObjectWrap::Unwrap<AoiShardedScene>(args.Holder())->scene_.get();
+}
+
+void AoiShardedScene::New (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+
+	if (!args.IsConstructCall())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Use the new operator to create a ShardedScene")));
+		return;
+	}
+
+	// Options: { shards: number, stripWidth: number, threads: number }
+	// The strips cover [0, shards * stripWidth) and the outer ones
+	// reach on to infinity. By default a thread works for every
+	// strip, up to the number of cores, the calling one included.
+	double shards = 0, strip_width = 0, threads = -1;
+	if (args.Length() == 1 && args[0]->IsObject())
+	{
+		Local<Object> options = args[0]->ToObject();
+		Local<Value> shards_value = options->Get(String::NewFromUtf8(isolate, "shards"));
+		Local<Value> width_value = options->Get(String::NewFromUtf8(isolate, "stripWidth"));
+		Local<Value> threads_value = options->Get(String::NewFromUtf8(isolate, "threads"));
+		shards = shards_value->NumberValue();
+		strip_width = width_value->NumberValue();
+		threads = threads_value->IsUndefined() ? -1 : threads_value->NumberValue();
+	}
+
+	if (!(shards >= 1 && shards <= ysd_bes_aoi::ShardedScene::kMaxShards && shards == static_cast<size_t>(shards))
+	        || !(strip_width > 0 && strip_width < std::numeric_limits<float>::infinity())
+	        || !(threads == -1 || (threads >= 0 && threads <= ysd_bes_aoi::ShardedScene::kMaxShards)))
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong options of ShardedScene")));
+		return;
+	}
+
+	size_t workers = static_cast<size_t>(threads);
+	if (threads == -1)
+	{
+		size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+		workers = std::min(static_cast<size_t>(shards), cores) - 1;
+	}
+
+	AoiShardedScene* obj = new AoiShardedScene(new ysd_bes_aoi::ShardedScene(shards, strip_width, workers));
+	obj->Wrap(args.This());
+	args.GetReturnValue().Set(args.This());
+}
+
+// Add a new player to the strip of its position.
+// @param[in]	args[0]		The id of the new player.
+// @param[in]	args[1] 	The x coordinate of the player's position.
+// @param[in]	args[2] 	The y coordinate of the player's position.
+// @param[out]	args		If the insert is successful?
+void AoiShardedScene::Insert (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	AoiId id;
+	if (scene == nullptr || !CheckNumberArgs(args, 3) || !ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+	args.GetReturnValue().Set(scene->Insert(id, args[1]->NumberValue(), args[2]->NumberValue()));
+}
+
+// Remove a player.
+// @param[in]	args[0]		The id of the removed player.
+// @param[out]	args		If the remove is successful?
+void AoiShardedScene::Remove (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	AoiId id;
+	if (scene == nullptr || !CheckNumberArgs(args, 1) || !ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+	args.GetReturnValue().Set(scene->Remove(id));
+}
+
+// Move a player, to another strip if it crosses a border.
+// @param[in]	args[0]		The id of the moved player.
+// @param[in]	args[1] 	The new x coordinate.
+// @param[in]	args[2] 	The new y coordinate.
+// @param[out]	args		If the update is successful?
+void AoiShardedScene::Update (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	AoiId id;
+	if (scene == nullptr || !CheckNumberArgs(args, 3) || !ToId(isolate, args[0], &id))
+	{
+		return;
+	}
+	args.GetReturnValue().Set(scene->Update(id, args[1]->NumberValue(), args[2]->NumberValue()));
+}
+
+// Move many players in one call, the strips in parallel.
+// @param[in]	args[0]		Uint16Array or Uint32Array of ids of the moved players.
+// @param[in]	args[1] 	Float32Array of new x coordinates.
+// @param[in]	args[2] 	Float32Array of new y coordinates.
+// @param[out]	args		Uint8Array bitmap, bit i is set if the i-th update is successful.
+void AoiShardedScene::UpdateMany (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	int64_t n = scene == nullptr ? -1 : CheckBatchArgs(args, 3);
+	if (n < 0)
+	{
+		return;
+	}
+
+	const AoiId* ids = IdArrayData(args[0].As<TypedArray>());
+	const float* xs = TypedArrayData<float>(args[1].As<TypedArray>());
+	const float* ys = TypedArrayData<float>(args[2].As<TypedArray>());
+	scene->UpdateMany(ids, xs, ys, n, batch_done);
+	args.GetReturnValue().Set(NewBitmap(args.GetIsolate(), batch_done));
+}
+
+// Search players in a given square range, with the same
+// bounds as AoiScene.search.
+// @param[in]	args[0], args[1]	X coordinate of the range.
+// @param[in] 	args[2], args[3]	Y coordinate of the range.
+// @param[out]	args				Array of ids of the players found.
+void AoiShardedScene::Search (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	if (scene == nullptr || !CheckNumberArgs(args, 4))
+	{
+		return;
+	}
+	const std::vector<AoiId>& ids = scene->Search(args[0]->NumberValue(), args[1]->NumberValue(),
+	                                args[2]->NumberValue(), args[3]->NumberValue());
+	args.GetReturnValue().Set(NewIdList(args.GetIsolate(), ids));
+}
+
+// Search players in many square ranges at once, see searchMany
+// of AoiScene for the arguments and the result.
+void AoiShardedScene::SearchMany (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	if (scene == nullptr)
+	{
+		return;
+	}
+
+	// Check the number of argiments passed.
+	if (args.Length() != 1)
+	{
+		isolate->ThrowException(Exception::Error(
+		                            String::NewFromUtf8(isolate, "Wrong number of arguments")));
+		return;
+	}
+
+	// Check the argument types.
+	if (!args[0]->IsFloat32Array())
+	{
+		isolate->ThrowException(Exception::TypeError(
+		                            String::NewFromUtf8(isolate, "Wrong types of arguments")));
+		return;
+	}
+
+	Local<TypedArray> rects = args[0].As<TypedArray>();
+	if (rects->Length() % 4 != 0)
+	{
+		isolate->ThrowException(Exception::RangeError(
+		                            String::NewFromUtf8(isolate, "Length of ranges is not a multiple of 4")));
+		return;
+	}
+
+	static std::vector<uint32_t> offsets;
+	static std::vector<AoiId> ids;
+	scene->SearchMany(TypedArrayData<float>(rects), rects->Length() / 4, offsets, ids);
+	args.GetReturnValue().Set(ManyResult(isolate, offsets, ids));
+}
+
+// Count players in a given square range, see count of AoiScene.
+void AoiShardedScene::Count (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	if (scene == nullptr || !CheckNumberArgs(args, 4, 1))
+	{
+		return;
+	}
+	bool estimate = args.Length() == 5 && args[4]->BooleanValue();
+	size_t count = scene->Count(args[0]->NumberValue(), args[1]->NumberValue(),
+	                            args[2]->NumberValue(), args[3]->NumberValue(), !estimate);
+	args.GetReturnValue().Set(static_cast<uint32_t>(count));
+}
+
+// Number of players in every strip, to see if the strips
+// are balanced.
+// @param[out]	args		Array of the numbers, from the west.
+void AoiShardedScene::ShardSizes (const FunctionCallbackInfo<Value>& args)
+{
+	Isolate* isolate = args.GetIsolate();
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	if (scene == nullptr)
+	{
+		return;
+	}
+	Local<Array> sizes = Array::New(isolate, scene->shards());
+	for (size_t i = 0; i < scene->shards(); ++i)
+	{
+		sizes->Set(i, Number::New(isolate, scene->ShardSize(i)));
+	}
+	args.GetReturnValue().Set(sizes);
+}
+
+void AoiShardedScene::Close (const FunctionCallbackInfo<Value>& args)
+{
+	ysd_bes_aoi::ShardedScene* scene = Get(args);
+	if (scene != nullptr)
+	{
+		scene->Close();
+	}
+}
+
+void AoiShardedScene::Init (Local<Object> exports)
+{
+	Isolate* isolate = exports->GetIsolate();
+
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+	tpl->SetClassName(String::NewFromUtf8(isolate, "ShardedScene"));
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+	NODE_SET_PROTOTYPE_METHOD(tpl, "insert", Insert);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "remove", Remove);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "update", Update);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "updateMany", UpdateMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "search", Search);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "searchMany", SearchMany);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "count", Count);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "shardSizes", ShardSizes);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "close", Close);
+
+	tpl_.Reset(isolate, tpl);
+	exports->Set(String::NewFromUtf8(isolate, "ShardedScene"), tpl->GetFunction());
+}
+
 void init (Local<Object> exports)
 {
 	NODE_SET_METHOD(exports, "insert", Insert);
 	NODE_SET_METHOD(exports, "remove", Remove);
 	NODE_SET_METHOD(exports, "search", Search);
+	NODE_SET_METHOD(exports, "searchInto", SearchInto);
+	NODE_SET_METHOD(exports, "searchMany", SearchMany);
+	NODE_SET_METHOD(exports, "searchAsync", SearchAsync);
+	NODE_SET_METHOD(exports, "searchManyAsync", SearchManyAsync);
+	NODE_SET_METHOD(exports, "count", Count);
+	NODE_SET_METHOD(exports, "publish", Publish);
+	NODE_SET_METHOD(exports, "searchPublished", SearchPublished);
+	NODE_SET_METHOD(exports, "searchRadius", SearchRadius);
+	NODE_SET_METHOD(exports, "nearest", Nearest);
 	NODE_SET_METHOD(exports, "update", Update);
+	NODE_SET_METHOD(exports, "insertMany", InsertMany);
+	NODE_SET_METHOD(exports, "removeMany", RemoveMany);
+	NODE_SET_METHOD(exports, "updateMany", UpdateMany);
+	NODE_SET_METHOD(exports, "load", Load);
+	NODE_SET_METHOD(exports, "save", Save);
+	NODE_SET_METHOD(exports, "restore", Restore);
 	NODE_SET_METHOD(exports, "range",  CheckRange);
+	NODE_SET_METHOD(exports, "flatten", Flatten);
+	NODE_SET_METHOD(exports, "watch", Watch);
+	NODE_SET_METHOD(exports, "unwatch", Unwatch);
+	NODE_SET_METHOD(exports, "events", Events);
+	NODE_SET_METHOD(exports, "stats", Stats);
 	NODE_SET_METHOD(exports, "print",  Print);
+	NODE_SET_METHOD(exports, "latencyReport", LatencyReport);
+	NODE_SET_METHOD(exports, "resetLatency", ResetLatency);
+
+	AoiScene::Init(exports);
+	AoiShardedScene::Init(exports);
 }
 
 NODE_MODULE(aoi_st, init)
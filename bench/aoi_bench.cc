@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////
+// @fileoverview Insert, update, search and remove of a
+// scene with 1k to 100k players, for every distribution.
+// Prints ops/sec and p50/p99 latency of every operation.
+// Usage: aoi_bench [tree|grid]
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "../scene.h"
+#include "workload.h"
+
+using namespace ysd_bes_aoi;
+
+typedef std::chrono::steady_clock Clock;
+
+// Update rounds, every round moves all players once.
+static const int kUpdateRounds = 5;
+
+// Latency of every call of an operation, in nanoseconds.
+class Samples final
+{
+public:
+
+	// Time one call of f.
+	template <typename F>
+	void Time (F f)
+	{
+		Clock::time_point start = Clock::now();
+		f();
+		ns_.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+	}
+
+	// Print a line of the table.
+	void Print (const char* backend, Distribution d, uint32_t n, const char* op)
+	{
+		double total = 0;
+		for (double ns : ns_)
+		{
+			total += ns;
+		}
+		std::sort(ns_.begin(), ns_.end());
+		printf("%-5s %-10s %7u %-7s %12.0f %9.0f %9.0f\n", backend, DistributionName(d), n, op,
+		       ns_.size() / total * 1e9, Percentile(0.50), Percentile(0.99));
+		ns_.clear();
+	}
+
+private:
+
+	double Percentile (double p) const
+	{
+		return ns_.empty() ? 0 : ns_[std::min(ns_.size() - 1, static_cast<size_t>(p * ns_.size()))];
+	}
+
+	std::vector<double> ns_;
+};
+
+static void Run (bool grid, Distribution d, uint32_t n)
+{
+	const char* backend = grid ? "grid" : "tree";
+	std::unique_ptr<Scene> scene(grid ? new Scene(2 * Workload::kView) : new Scene());
+	Workload workload(d, n);
+	Samples samples;
+
+	std::vector<float> xs(n), ys(n);
+	for (uint32_t id = 0; id < n; ++id)
+	{
+		workload.Place(&xs[id], &ys[id]);
+		samples.Time([&] ( )
+		{
+			scene->Insert(id, xs[id], ys[id]);
+		});
+	}
+	samples.Print(backend, d, n, "insert");
+
+	for (int round = 0; round < kUpdateRounds; ++round)
+	{
+		for (uint32_t id = 0; id < n; ++id)
+		{
+			workload.Move(&xs[id], &ys[id]);
+			samples.Time([&] ( )
+			{
+				scene->Update(id, xs[id], ys[id]);
+			});
+		}
+	}
+	samples.Print(backend, d, n, "update");
+
+	// Every player looks around itself, as a game tick does.
+	size_t hits = 0;
+	for (uint32_t id = 0; id < n; ++id)
+	{
+		samples.Time([&] ( )
+		{
+			hits += scene->Search(xs[id] - Workload::kView, xs[id] + Workload::kView,
+			                      ys[id] - Workload::kView, ys[id] + Workload::kView).size();
+		});
+	}
+	samples.Print(backend, d, n, "search");
+
+	for (uint32_t id = 0; id < n; ++id)
+	{
+		samples.Time([&] ( )
+		{
+			scene->Remove(id);
+		});
+	}
+	samples.Print(backend, d, n, "remove");
+
+	// Print the hits so the searches are not optimized away.
+	fprintf(stderr, "%s %s %u: %zu hits\n", backend, DistributionName(d), n, hits);
+}
+
+int main (int argc, char** argv)
+{
+	bool grid = argc > 1 && strcmp(argv[1], "grid") == 0;
+
+	printf("%-5s %-10s %7s %-7s %12s %9s %9s\n", "scene", "dist", "n", "op", "ops/s", "p50(ns)", "p99(ns)");
+	for (Distribution d : {kUniform, kClustered, kCorridor})
+	{
+		for (uint32_t n : {1000u, 10000u, 100000u})
+		{
+			Run(grid, d, n);
+		}
+	}
+	return 0;
+}
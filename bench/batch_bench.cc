@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////
+// @fileoverview Batch calls of a scene changing both
+// trees on the calling thread, against the x and y
+// trees at once on a pool of one worker.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../scene.h"
+
+using namespace ysd_bes_aoi;
+
+static const uint32_t kPlayers = 100000;
+static const float kMapSize = 4000;
+static const float kStep = 2;
+static const int kRounds = 20;
+
+// Print the mean of the microseconds f times over the rounds.
+template <typename F>
+static double Measure (const char* name, F f)
+{
+	double us = 0;
+	for (int r = 0; r < kRounds; ++r)
+	{
+		us += f();
+	}
+	printf("%-28s %9.0f us/round\n", name, us / kRounds);
+	return us / kRounds;
+}
+
+// Time one call of f in microseconds.
+template <typename F>
+static double Time (F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main ( )
+{
+	printf("%u players, %u cores\n", kPlayers, std::thread::hardware_concurrency());
+	srand(1);
+
+	std::vector<AoiId> ids(kPlayers);
+	std::vector<float> xs(kPlayers), ys(kPlayers);
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		ids[id] = id;
+		xs[id] = rand() % static_cast<int>(kMapSize);
+		ys[id] = rand() % static_cast<int>(kMapSize);
+	}
+
+	WorkerPool pool(1);
+	std::vector<uint8_t> done;
+	for (WorkerPool* p : {static_cast<WorkerPool*>(nullptr), &pool})
+	{
+		const char* suffix = p ? "x|y on 2 threads" : "x then y";
+		char name[64];
+		Scene scene;
+
+		snprintf(name, sizeof(name), "Load, %s", suffix);
+		Measure(name, [&] ( )
+		{
+			return Time([&] ( )
+			{
+				scene.Load(ids.data(), xs.data(), ys.data(), kPlayers, p);
+			});
+		});
+
+		// The same moves for both, every player a step each round.
+		std::vector<float> mxs = xs, mys = ys;
+		srand(2);
+		snprintf(name, sizeof(name), "UpdateMany, %s", suffix);
+		Measure(name, [&] ( )
+		{
+			for (uint32_t id = 0; id < kPlayers; ++id)
+			{
+				mxs[id] += (rand() % 3 - 1) * kStep;
+				mys[id] += (rand() % 3 - 1) * kStep;
+			}
+			return Time([&] ( )
+			{
+				scene.UpdateMany(ids.data(), mxs.data(), mys.data(), kPlayers, done, p);
+			});
+		});
+	}
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////
+// @fileoverview The workloads of aoi_bench run through
+// the binding, to see the cost of the js calls: compare
+// the numbers with the ones of aoi_bench.
+// Usage: node bench.js [tree|grid]
+// @author ysd
+//////////////////////////////////////////////////
+
+'use strict';
+
+const aoi = require('../build/Release/aoi_st');
+
+const f = Math.fround;
+
+const UPDATE_ROUNDS = 5;
+
+// Same as workload.h.
+const VIEW = 50;
+const STEP = 2;
+const UNIFORM = 0, CLUSTERED = 1, CORRIDOR = 2;
+const NAMES = ['uniform', 'clustered', 'corridor'];
+
+class Workload {
+	constructor (distribution, n) {
+		this.distribution = distribution;
+		this.mapSize = f(f(Math.sqrt(n)) * 10);
+		this.state = (Math.imul(n, 2654435761 | 0) + distribution + 1) >>> 0;
+	}
+
+	// xorshift32.
+	next () {
+		let s = this.state;
+		s = (s ^ (s << 13)) >>> 0;
+		s = (s ^ (s >>> 17)) >>> 0;
+		s = (s ^ (s << 5)) >>> 0;
+		this.state = s;
+		return s;
+	}
+
+	uniform (lo, hi) {
+		return f(lo + f(f(hi - lo) * f((this.next() >>> 8) / (1 << 24))));
+	}
+
+	place () {
+		const mid = f(this.mapSize / 2);
+		const ms = this.mapSize;
+		switch (this.distribution) {
+			case UNIFORM:
+				return [this.uniform(0, ms), this.uniform(0, ms)];
+			case CLUSTERED:
+				if (this.next() % 10 < 8) {
+					const w = f(ms / 20);
+					const x = f(mid + this.uniform(-w, w));
+					return [x, f(mid + this.uniform(-w, w))];
+				}
+				return [this.uniform(0, ms), this.uniform(0, ms)];
+			default:
+				return [this.uniform(0, ms), f(mid + this.uniform(-VIEW / 5, VIEW / 5))];
+		}
+	}
+
+	move (p) {
+		const clamp = (v, lo, hi) => Math.max(lo, Math.min(hi, v));
+		p[0] = clamp(f(p[0] + this.uniform(-STEP, STEP)), 0, this.mapSize);
+		p[1] = f(p[1] + this.uniform(-STEP, STEP));
+		if (this.distribution === CORRIDOR) {
+			const mid = f(this.mapSize / 2);
+			p[1] = clamp(p[1], f(mid - VIEW / 5), f(mid + VIEW / 5));
+		} else {
+			p[1] = clamp(p[1], 0, this.mapSize);
+		}
+	}
+}
+
+// Latency of every call of an operation, in nanoseconds.
+class Samples {
+	constructor () {
+		this.ns = [];
+	}
+
+	time (fn) {
+		const start = process.hrtime.bigint();
+		fn();
+		this.ns.push(Number(process.hrtime.bigint() - start));
+	}
+
+	print (backend, distribution, n, op) {
+		const total = this.ns.reduce((a, b) => a + b, 0);
+		this.ns.sort((a, b) => a - b);
+		const pct = p => this.ns[Math.min(this.ns.length - 1, Math.floor(p * this.ns.length))];
+		console.log([
+			backend.padEnd(5), NAMES[distribution].padEnd(10), String(n).padStart(7), op.padEnd(7),
+			(this.ns.length / total * 1e9).toFixed(0).padStart(12), String(pct(0.5)).padStart(9), String(pct(0.99)).padStart(9)
+		].join(' '));
+		this.ns = [];
+	}
+}
+
+function run (grid, distribution, n) {
+	const backend = grid ? 'grid' : 'tree';
+	const scene = grid ? new aoi.AoiScene({ backend: 'grid', cellSize: 2 * VIEW }) : new aoi.AoiScene();
+	const workload = new Workload(distribution, n);
+	const samples = new Samples();
+
+	const pos = [];
+	for (let id = 0; id < n; ++id) {
+		const p = workload.place();
+		pos.push(p);
+		samples.time(() => scene.insert(id, p[0], p[1]));
+	}
+	samples.print(backend, distribution, n, 'insert');
+
+	for (let round = 0; round < UPDATE_ROUNDS; ++round) {
+		for (let id = 0; id < n; ++id) {
+			const p = pos[id];
+			workload.move(p);
+			samples.time(() => scene.update(id, p[0], p[1]));
+		}
+	}
+	samples.print(backend, distribution, n, 'update');
+
+	let hits = 0;
+	for (let id = 0; id < n; ++id) {
+		const p = pos[id];
+		samples.time(() => {
+			hits += scene.search(p[0] - VIEW, p[0] + VIEW, p[1] - VIEW, p[1] + VIEW).length;
+		});
+	}
+	samples.print(backend, distribution, n, 'search');
+
+	for (let id = 0; id < n; ++id) {
+		samples.time(() => scene.remove(id));
+	}
+	samples.print(backend, distribution, n, 'remove');
+
+	scene.close();
+	console.error(`${backend} ${NAMES[distribution]} ${n}: ${hits} hits`);
+}
+
+const grid = process.argv[2] === 'grid';
+console.log('scene dist             n op             ops/s   p50(ns)   p99(ns)');
+for (const distribution of [UNIFORM, CLUSTERED, CORRIDOR]) {
+	for (const n of [1000, 10000, 100000]) {
+		run(grid, distribution, n);
+	}
+}
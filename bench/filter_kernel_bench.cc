@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////
+// @fileoverview Cost per candidate of the second axis
+// filter: branchy loop, scalar kernel and SIMD kernel.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "../filter_kernel.h"
+
+using namespace ysd_bes_aoi;
+
+static const uint32_t kPlayers = 10000;
+static const int kRounds = 500;
+
+// Print nanoseconds per candidate of running f over all rounds.
+template <typename F>
+static void Measure (const char* name, size_t candidates, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t hits = 0;
+	for (int r = 0; r < kRounds; ++r)
+	{
+		hits += f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+	// Print the hits so the work is not optimized away.
+	printf("%s: %.2f ns/candidate (%zu hits)\n", name, ns / (static_cast<double>(candidates) * kRounds), hits);
+}
+
+int main ( )
+{
+	srand(1);
+
+	std::vector<float> xs(kPlayers), ys(kPlayers);
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		xs[id] = rand() % 1000;
+		ys[id] = rand() % 1000;
+	}
+
+	// A wide query: the candidates of a x range, in random id order.
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < kPlayers; ++i)
+	{
+		candidates.push_back(rand() % kPlayers);
+	}
+
+	const FilterBox box = {0, 1000, 250, 750};
+	std::vector<uint32_t> out(candidates.size() + kFilterPadding);
+
+	Measure("branchy loop", candidates.size(), [&] ( )
+	{
+		size_t count = 0;
+		for (uint32_t id : candidates)
+		{
+			if (ys[id] >= box.y_lo && ys[id] <= box.y_hi && xs[id] >= box.x_lo && xs[id] <= box.x_hi)
+				out[count++] = id;
+		}
+		return count;
+	});
+
+	Measure("FilterIdsScalar", candidates.size(), [&] ( )
+	{
+		return FilterIdsScalar(candidates.data(), candidates.size(), xs.data(), ys.data(), box, out.data());
+	});
+
+	Measure("FilterIds", candidates.size(), [&] ( )
+	{
+		return FilterIds(candidates.data(), candidates.size(), xs.data(), ys.data(), box, out.data());
+	});
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////
+// @fileoverview Cost per search hit of the position
+// lookup: hash map against the dense position store.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include "../position_store.h"
+
+using namespace ysd_bes_aoi;
+
+static const uint32_t kPlayers = 10000;
+static const int kRounds = 200;
+
+// Print nanoseconds per candidate of running f over all rounds.
+template <typename F>
+static void Measure (const char* name, size_t candidates, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t hits = 0;
+	for (int r = 0; r < kRounds; ++r)
+	{
+		hits += f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+	// Print the hits so the work is not optimized away.
+	printf("%s: %.2f ns/hit (%zu hits)\n", name, ns / (static_cast<double>(candidates) * kRounds), hits);
+}
+
+int main ( )
+{
+	srand(1);
+
+	std::unordered_map<uint32_t, std::pair<float, float>> map;
+	PositionStore store;
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		float x = rand() % 1000, y = rand() % 1000;
+		map.emplace(id, std::make_pair(x, y));
+		store.Insert(id, x, y);
+	}
+
+	// Candidates come out of a tree in coordinate order, so their ids are random.
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < kPlayers; ++i)
+	{
+		candidates.push_back(rand() % kPlayers);
+	}
+
+	const float y_start = 250, y_end = 750;
+	std::vector<uint32_t> out;
+	out.reserve(candidates.size());
+
+	Measure("unordered_map", candidates.size(), [&] ( )
+	{
+		out.clear();
+		for (uint32_t id : candidates)
+		{
+			const std::pair<float, float>& p = map.find(id)->second;
+			if (p.second > y_start && p.second < y_end)
+				out.push_back(id);
+		}
+		return out.size();
+	});
+
+	Measure("PositionStore", candidates.size(), [&] ( )
+	{
+		out.clear();
+		const float* ys = store.ys();
+		for (uint32_t id : candidates)
+		{
+			if (ys[id] > y_start && ys[id] < y_end)
+				out.push_back(id);
+		}
+		return out.size();
+	});
+
+	return 0;
+}
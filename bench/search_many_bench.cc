@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////
+// @fileoverview One view range per player: a Search
+// call for each against one SearchMany call.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "../scene.h"
+
+using namespace ysd_bes_aoi;
+
+static const uint32_t kPlayers = 10000;
+static const float kMapSize = 2000;
+static const float kView = 100;
+static const int kRounds = 20;
+
+// Print microseconds per round of running f.
+template <typename F>
+static void Measure (const char* name, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t hits = 0;
+	for (int r = 0; r < kRounds; ++r)
+	{
+		hits += f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double us = std::chrono::duration<double, std::micro>(end - start).count();
+
+	// Print the hits so the work is not optimized away.
+	printf("%s: %.0f us/round (%zu hits)\n", name, us / kRounds, hits);
+}
+
+int main ( )
+{
+	srand(1);
+
+	std::vector<AoiId> ids;
+	std::vector<float> xs, ys, rects;
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		ids.push_back(id);
+		xs.push_back(rand() % static_cast<int>(kMapSize));
+		ys.push_back(rand() % static_cast<int>(kMapSize));
+		float r[4] = {xs.back() - kView, xs.back() + kView, ys.back() - kView, ys.back() + kView};
+		rects.insert(rects.end(), r, r + 4);
+	}
+
+	Scene scene;
+	scene.Load(ids.data(), xs.data(), ys.data(), kPlayers);
+
+	Measure("Search x N", [&] ( )
+	{
+		size_t hits = 0;
+		for (uint32_t i = 0; i < kPlayers; ++i)
+		{
+			const float* r = &rects[4 * i];
+			hits += scene.Search(r[0], r[1], r[2], r[3]).size();
+		}
+		return hits;
+	});
+
+	std::vector<uint32_t> offsets;
+	std::vector<AoiId> found;
+	Measure("SearchMany", [&] ( )
+	{
+		scene.SearchMany(rects.data(), kPlayers, offsets, found);
+		return found.size();
+	});
+
+	return 0;
+}
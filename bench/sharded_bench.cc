@@ -0,0 +1,139 @@
+//////////////////////////////////////////////////
+// @fileoverview A tick of moves and view searches of
+// every player: one Scene against a ShardedScene with
+// 1 to N threads. Only the scene calls are timed, and
+// the speedup is against the ShardedScene on 1 thread.
+// Usage: sharded_bench [threads]
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../sharded_scene.h"
+
+using namespace ysd_bes_aoi;
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint32_t kPlayers = 100000;
+static const float kMapSize = 4000;
+static const float kView = 100;
+static const float kStep = 2;
+static const size_t kShards = 8;
+static const int kRounds = 20;
+
+static double Us (Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Move every player a step, the same steps after the same
+// srand, and put its view range into rects.
+static void Tick (std::vector<float>& xs, std::vector<float>& ys, std::vector<float>& rects)
+{
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		xs[id] += (rand() % 3 - 1) * kStep;
+		ys[id] += (rand() % 3 - 1) * kStep;
+		float r[4] = {xs[id] - kView, xs[id] + kView, ys[id] - kView, ys[id] + kView};
+		std::copy(r, r + 4, &rects[4 * id]);
+	}
+}
+
+// Run kRounds ticks, timing the updates and the searches of
+// every tick apart from making the moves, and print a line.
+// @param[in]	base 	Microseconds per tick to print the speedup
+//						against, 0 for none.
+// @return 	Microseconds per tick.
+template <typename U, typename S>
+static double Measure (const char* name, size_t threads, double base, std::vector<float> xs, std::vector<float> ys,
+                       U update, S search)
+{
+	std::vector<float> rects(4 * kPlayers);
+	double update_us = 0, search_us = 0;
+	size_t hits = 0;
+	srand(2);
+	for (int r = 0; r < kRounds; ++r)
+	{
+		Tick(xs, ys, rects);
+		Clock::time_point start = Clock::now();
+		update(xs, ys);
+		Clock::time_point mid = Clock::now();
+		hits += search(rects);
+		search_us += Us(mid, Clock::now());
+		update_us += Us(start, mid);
+	}
+	double tick = (update_us + search_us) / kRounds;
+
+	// Print the hits so the work is not optimized away.
+	printf("%-18s %2zu threads: update %7.0f us, search %7.0f us, tick %7.0f us", name, threads,
+	       update_us / kRounds, search_us / kRounds, tick);
+	if (base > 0)
+	{
+		printf(", x%.2f", base / tick);
+	}
+	printf(" (%zu hits)\n", hits);
+	return tick;
+}
+
+int main (int argc, char** argv)
+{
+	size_t cores = std::thread::hardware_concurrency();
+	size_t max_threads = argc > 1 ? atoi(argv[1]) : cores;
+	printf("%zu players, %zu strips, %zu cores\n", static_cast<size_t>(kPlayers), kShards, cores);
+	srand(1);
+
+	std::vector<AoiId> ids(kPlayers);
+	std::vector<float> xs(kPlayers), ys(kPlayers);
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		ids[id] = id;
+		xs[id] = rand() % static_cast<int>(kMapSize);
+		ys[id] = rand() % static_cast<int>(kMapSize);
+	}
+
+	std::vector<uint32_t> offsets;
+	std::vector<AoiId> found;
+	std::vector<uint8_t> updated;
+
+	Scene scene;
+	scene.Load(ids.data(), xs.data(), ys.data(), kPlayers);
+	Measure("Scene", 1, 0, xs, ys, [&] (const std::vector<float>& mx, const std::vector<float>& my)
+	{
+		for (uint32_t id = 0; id < kPlayers; ++id)
+		{
+			scene.Update(id, mx[id], my[id]);
+		}
+	}, [&] (const std::vector<float>& rects)
+	{
+		scene.SearchMany(rects.data(), kPlayers, offsets, found);
+		return found.size();
+	});
+
+	double base = 0;
+	for (size_t threads = 1; threads <= std::max<size_t>(max_threads, 1); threads *= 2)
+	{
+		ShardedScene sharded(kShards, kMapSize / kShards, threads - 1);
+		for (uint32_t id = 0; id < kPlayers; ++id)
+		{
+			sharded.Insert(id, xs[id], ys[id]);
+		}
+		double tick = Measure("ShardedScene", threads, base, xs, ys, [&] (const std::vector<float>& mx, const std::vector<float>& my)
+		{
+			sharded.UpdateMany(ids.data(), mx.data(), my.data(), kPlayers, updated);
+		}, [&] (const std::vector<float>& rects)
+		{
+			sharded.SearchMany(rects.data(), kPlayers, offsets, found);
+			return found.size();
+		});
+		if (threads == 1)
+		{
+			base = tick;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+//////////////////////////////////////////////////
+// @fileoverview Player positions and moves shared by
+// the benchmarks. bench.js makes the same numbers.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+
+namespace ysd_bes_aoi
+{
+
+	// How players are spread over the map.
+	enum Distribution
+	{
+		// All over the map.
+		kUniform,
+
+		// Most players crowd around the middle, like a town square.
+		kClustered,
+
+		// All players on a narrow band along x, like a road.
+		kCorridor,
+	};
+
+	inline const char* DistributionName (Distribution d)
+	{
+		return d == kUniform ? "uniform" : d == kClustered ? "clustered" : "corridor";
+	}
+
+	// xorshift32, so bench.js can make the same sequence.
+	struct Rng
+	{
+		explicit Rng (uint32_t seed) :
+			state (seed)
+		{
+
+		}
+
+		uint32_t Next ( )
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		// Uniform in [lo, hi).
+		float Uniform (float lo, float hi)
+		{
+			return lo + (hi - lo) * static_cast<float>(Next() >> 8) * (1.0f / (1 << 24));
+		}
+
+		uint32_t state;
+	};
+
+	///////////////////////////////////////////////////
+	// Positions of n players on a square map sized so
+	// there is one player per 100 square units, and
+	// random walk moves of them.
+	///////////////////////////////////////////////////
+	class Workload final
+	{
+	public:
+
+		// Half width of the view range of a player.
+		static constexpr float kView = 50;
+
+		// Longest step of a move on each axis.
+		static constexpr float kStep = 2;
+
+		Workload (Distribution d, uint32_t n) :
+			distribution (d), map_size (sqrtf(static_cast<float>(n)) * 10), rng_ (n * 2654435761u + d + 1)
+		{
+
+		}
+
+		// A new position.
+		void Place (float* x, float* y)
+		{
+			float mid = map_size / 2;
+			switch (distribution)
+			{
+				case kUniform:
+					*x = rng_.Uniform(0, map_size);
+					*y = rng_.Uniform(0, map_size);
+					break;
+				case kClustered:
+					// 80% in a square a tenth of the map wide.
+					if (rng_.Next() % 10 < 8)
+					{
+						*x = mid + rng_.Uniform(-map_size / 20, map_size / 20);
+						*y = mid + rng_.Uniform(-map_size / 20, map_size / 20);
+					}
+					else
+					{
+						*x = rng_.Uniform(0, map_size);
+						*y = rng_.Uniform(0, map_size);
+					}
+					break;
+				case kCorridor:
+					*x = rng_.Uniform(0, map_size);
+					*y = mid + rng_.Uniform(-kView / 5, kView / 5);
+					break;
+			}
+		}
+
+		// Move a position one random step, staying on the map,
+		// or in the road for a corridor.
+		void Move (float* x, float* y)
+		{
+			*x = Clamp(*x + rng_.Uniform(-kStep, kStep), 0, map_size);
+			*y = *y + rng_.Uniform(-kStep, kStep);
+			if (distribution == kCorridor)
+			{
+				*y = Clamp(*y, map_size / 2 - kView / 5, map_size / 2 + kView / 5);
+			}
+			else
+			{
+				*y = Clamp(*y, 0, map_size);
+			}
+		}
+
+		const Distribution distribution;
+		const float map_size;
+
+	private:
+
+		static float Clamp (float v, float lo, float hi)
+		{
+			return std::max(lo, std::min(hi, v));
+		}
+
+		Rng rng_;
+	};
+}
+
+#endif
@@ -2,7 +2,14 @@
   "targets": [
     {
       "target_name": "aoi_st",
-      "sources": ["segment_tree.cc", "aoi_segment_tree.cc"]
+      "variables": {
+        # Width of player ids, 16 or 32 bits.
+        "aoi_id_bits%": 32,
+        # 1 to count nodes visited and rotations of the trees.
+        "aoi_stats%": 0
+      },
+      "defines": ["AOI_ID_BITS=<(aoi_id_bits)", "AOI_STATS=<(aoi_stats)"],
+      "sources": ["segment_tree.cc", "flat_layout.cc", "grid_index.cc", "filter_kernel.cc", "interest_tracker.cc", "scene_view.cc", "scene.cc", "snapshot.cc", "worker_pool.cc", "sharded_scene.cc", "aoi_segment_tree.cc"]
     }
   ]
 }
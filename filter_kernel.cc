@@ -0,0 +1,295 @@
+//////////////////////////////////////////////////
+// @fileoverview Filter of search candidates by position.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include "filter_kernel.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AOI_FILTER_AVX2 1
+#include <immintrin.h>
+#endif
+
+using namespace ysd_bes_aoi;
+
+#ifdef AOI_FILTER_AVX2
+
+// For every 8 bit mask, the indexes of its set bits packed
+// to the low bytes, to compact kept lanes with one permute.
+struct CompactTable
+{
+	CompactTable ( )
+	{
+		for (int mask = 0; mask < 256; ++mask)
+		{
+			uint64_t packed = 0;
+			int k = 0;
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				if (mask & (1 << lane))
+				{
+					packed |= static_cast<uint64_t>(lane) << (8 * k++);
+				}
+			}
+			lanes[mask] = packed;
+		}
+	}
+
+	uint64_t lanes[256];
+};
+
+static const CompactTable kCompact;
+
+// Load 8 ids widened to 32 bits.
+__attribute__((target("avx2")))
+static inline __m256i LoadIds (const uint32_t* ids)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i LoadIds (const uint16_t* ids)
+{
+	return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ids)));
+}
+
+// Store 8 ids narrowed from 32 bits.
+__attribute__((target("avx2")))
+static inline void StoreIds (uint32_t* out, __m256i ids)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), ids);
+}
+
+__attribute__((target("avx2")))
+static inline void StoreIds (uint16_t* out, __m256i ids)
+{
+	// Ids fit in 16 bits, so the saturation never happens.
+	__m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(ids), _mm256_extracti128_si256(ids, 1));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+}
+
+// Store the lanes of the mask to out, packed.
+// @return 	Number of lanes stored.
+template <typename Id>
+__attribute__((target("avx2")))
+static inline size_t Compact (Id* out, __m256i id8, int mask)
+{
+	__m256i lanes = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(kCompact.lanes[mask]));
+	StoreIds(out, _mm256_permutevar8x32_epi32(id8, lanes));
+	return __builtin_popcount(mask);
+}
+
+template <typename Id>
+__attribute__((target("avx2")))
+static size_t FilterIdsAvx2 (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box, Id* out)
+{
+	const __m256 x_lo = _mm256_set1_ps(box.x_lo);
+	const __m256 x_hi = _mm256_set1_ps(box.x_hi);
+	const __m256 y_lo = _mm256_set1_ps(box.y_lo);
+	const __m256 y_hi = _mm256_set1_ps(box.y_hi);
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i id8 = LoadIds(ids + i);
+		__m256 x = _mm256_i32gather_ps(xs, id8, 4);
+		__m256 y = _mm256_i32gather_ps(ys, id8, 4);
+
+		// Ordered compares, so NaN positions are never kept.
+		__m256 in_x = _mm256_and_ps(_mm256_cmp_ps(x, x_lo, _CMP_GE_OQ), _mm256_cmp_ps(x, x_hi, _CMP_LE_OQ));
+		__m256 in_y = _mm256_and_ps(_mm256_cmp_ps(y, y_lo, _CMP_GE_OQ), _mm256_cmp_ps(y, y_hi, _CMP_LE_OQ));
+		int mask = _mm256_movemask_ps(_mm256_and_ps(in_x, in_y));
+		if (mask != 0)
+		{
+			count += Compact(out + count, id8, mask);
+		}
+	}
+
+	return count + FilterIdsScalar(ids + i, n - i, xs, ys, box, out + count);
+}
+
+template <typename Id>
+__attribute__((target("avx2")))
+static size_t FilterRunAvx2 (const Id* ids, const float* values, size_t n, float lo, float hi, Id* out)
+{
+	const __m256 lo8 = _mm256_set1_ps(lo);
+	const __m256 hi8 = _mm256_set1_ps(hi);
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(values + i);
+		__m256 in = _mm256_and_ps(_mm256_cmp_ps(v, lo8, _CMP_GE_OQ), _mm256_cmp_ps(v, hi8, _CMP_LE_OQ));
+		int mask = _mm256_movemask_ps(in);
+		if (mask != 0)
+		{
+			count += Compact(out + count, LoadIds(ids + i), mask);
+		}
+	}
+
+	return count + FilterRunScalar(ids + i, values + i, n - i, lo, hi, out + count);
+}
+
+template <typename Id>
+__attribute__((target("avx2")))
+static size_t CountIdsAvx2 (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box)
+{
+	const __m256 x_lo = _mm256_set1_ps(box.x_lo);
+	const __m256 x_hi = _mm256_set1_ps(box.x_hi);
+	const __m256 y_lo = _mm256_set1_ps(box.y_lo);
+	const __m256 y_hi = _mm256_set1_ps(box.y_hi);
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i id8 = LoadIds(ids + i);
+		__m256 x = _mm256_i32gather_ps(xs, id8, 4);
+		__m256 y = _mm256_i32gather_ps(ys, id8, 4);
+		__m256 in_x = _mm256_and_ps(_mm256_cmp_ps(x, x_lo, _CMP_GE_OQ), _mm256_cmp_ps(x, x_hi, _CMP_LE_OQ));
+		__m256 in_y = _mm256_and_ps(_mm256_cmp_ps(y, y_lo, _CMP_GE_OQ), _mm256_cmp_ps(y, y_hi, _CMP_LE_OQ));
+		count += __builtin_popcount(_mm256_movemask_ps(_mm256_and_ps(in_x, in_y)));
+	}
+
+	return count + CountIdsScalar(ids + i, n - i, xs, ys, box);
+}
+
+__attribute__((target("avx2")))
+static size_t CountRunAvx2 (const float* values, size_t n, float lo, float hi)
+{
+	const __m256 lo8 = _mm256_set1_ps(lo);
+	const __m256 hi8 = _mm256_set1_ps(hi);
+
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(values + i);
+		__m256 in = _mm256_and_ps(_mm256_cmp_ps(v, lo8, _CMP_GE_OQ), _mm256_cmp_ps(v, hi8, _CMP_LE_OQ));
+		count += __builtin_popcount(_mm256_movemask_ps(in));
+	}
+
+	return count + CountRunScalar(values + i, n - i, lo, hi);
+}
+
+#endif
+
+template <typename Id>
+size_t ysd_bes_aoi::FilterIdsScalar (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box, Id* out)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		// Write every id and only move on if it is kept, no branch.
+		Id id = ids[i];
+		float x = xs[id], y = ys[id];
+		out[count] = id;
+		count += (x >= box.x_lo) & (x <= box.x_hi) & (y >= box.y_lo) & (y <= box.y_hi);
+	}
+	return count;
+}
+
+template <typename Id>
+size_t ysd_bes_aoi::FilterRunScalar (const Id* ids, const float* values, size_t n, float lo, float hi, Id* out)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		out[count] = ids[i];
+		count += (values[i] >= lo) & (values[i] <= hi);
+	}
+	return count;
+}
+
+template <typename Id>
+size_t ysd_bes_aoi::CountIdsScalar (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		float x = xs[ids[i]], y = ys[ids[i]];
+		count += (x >= box.x_lo) & (x <= box.x_hi) & (y >= box.y_lo) & (y <= box.y_hi);
+	}
+	return count;
+}
+
+size_t ysd_bes_aoi::CountRunScalar (const float* values, size_t n, float lo, float hi)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		count += (values[i] >= lo) & (values[i] <= hi);
+	}
+	return count;
+}
+
+#ifdef AOI_FILTER_AVX2
+// If the cpu has AVX2, checked once.
+static bool HasAvx2 ( )
+{
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	return has_avx2;
+}
+#endif
+
+template <typename Id>
+size_t ysd_bes_aoi::FilterIds (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box, Id* out)
+{
+#ifdef AOI_FILTER_AVX2
+	if (HasAvx2())
+	{
+		return FilterIdsAvx2(ids, n, xs, ys, box, out);
+	}
+#endif
+	return FilterIdsScalar(ids, n, xs, ys, box, out);
+}
+
+template <typename Id>
+size_t ysd_bes_aoi::FilterRun (const Id* ids, const float* values, size_t n, float lo, float hi, Id* out)
+{
+#ifdef AOI_FILTER_AVX2
+	if (HasAvx2())
+	{
+		return FilterRunAvx2(ids, values, n, lo, hi, out);
+	}
+#endif
+	return FilterRunScalar(ids, values, n, lo, hi, out);
+}
+
+template <typename Id>
+size_t ysd_bes_aoi::CountIds (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box)
+{
+#ifdef AOI_FILTER_AVX2
+	if (HasAvx2())
+	{
+		return CountIdsAvx2(ids, n, xs, ys, box);
+	}
+#endif
+	return CountIdsScalar(ids, n, xs, ys, box);
+}
+
+size_t ysd_bes_aoi::CountRun (const float* values, size_t n, float lo, float hi)
+{
+#ifdef AOI_FILTER_AVX2
+	if (HasAvx2())
+	{
+		return CountRunAvx2(values, n, lo, hi);
+	}
+#endif
+	return CountRunScalar(values, n, lo, hi);
+}
+
+template size_t ysd_bes_aoi::FilterIds<uint16_t> (const uint16_t*, size_t, const float*, const float*, const FilterBox&, uint16_t*);
+template size_t ysd_bes_aoi::FilterIds<uint32_t> (const uint32_t*, size_t, const float*, const float*, const FilterBox&, uint32_t*);
+template size_t ysd_bes_aoi::FilterIdsScalar<uint16_t> (const uint16_t*, size_t, const float*, const float*, const FilterBox&, uint16_t*);
+template size_t ysd_bes_aoi::FilterIdsScalar<uint32_t> (const uint32_t*, size_t, const float*, const float*, const FilterBox&, uint32_t*);
+template size_t ysd_bes_aoi::FilterRun<uint16_t> (const uint16_t*, const float*, size_t, float, float, uint16_t*);
+template size_t ysd_bes_aoi::FilterRun<uint32_t> (const uint32_t*, const float*, size_t, float, float, uint32_t*);
+template size_t ysd_bes_aoi::FilterRunScalar<uint16_t> (const uint16_t*, const float*, size_t, float, float, uint16_t*);
+template size_t ysd_bes_aoi::FilterRunScalar<uint32_t> (const uint32_t*, const float*, size_t, float, float, uint32_t*);
+template size_t ysd_bes_aoi::CountIds<uint16_t> (const uint16_t*, size_t, const float*, const float*, const FilterBox&);
+template size_t ysd_bes_aoi::CountIds<uint32_t> (const uint32_t*, size_t, const float*, const float*, const FilterBox&);
+template size_t ysd_bes_aoi::CountIdsScalar<uint16_t> (const uint16_t*, size_t, const float*, const float*, const FilterBox&);
+template size_t ysd_bes_aoi::CountIdsScalar<uint32_t> (const uint32_t*, size_t, const float*, const float*, const FilterBox&);
@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////
+// @fileoverview Filter of search candidates by position.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _FILTER_KERNEL_H_
+#define _FILTER_KERNEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ysd_bes_aoi
+{
+
+	// Extra room FilterIds may write past the ids it keeps.
+	const size_t kFilterPadding = 8;
+
+	// Closed square range [x_lo, x_hi] x [y_lo, y_hi]. An exclusive
+	// bound is made closed with nextafterf, so one kernel fits both.
+	struct FilterBox
+	{
+		float x_lo;
+		float x_hi;
+		float y_lo;
+		float y_hi;
+	};
+
+	// Keep the candidates which position is in the box.
+	// Uses AVX2 when the cpu has it, 8 candidates at a time.
+	// @param[in]	ids 	Candidate ids.
+	// @param[in]	n 		Number of candidates.
+	// @param[in]	xs 		X coordinates, indexed by id.
+	// @param[in]	ys 		Y coordinates, indexed by id.
+	// @param[out]	out 	Kept ids, in order. Must have room for
+	//						n + kFilterPadding ids.
+	// @return 	Number of kept ids.
+	template <typename Id>
+	size_t FilterIds (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box, Id* out);
+
+	// Keep the ids which coordinate, stored in the same order as the
+	// ids, is in [lo, hi]. Reads linear memory only, no gather.
+	// @param[in]	ids 	Candidate ids.
+	// @param[in]	values 	Coordinate of every candidate.
+	// @param[in]	n 		Number of candidates.
+	// @param[out]	out 	Kept ids, in order. Must have room for
+	//						n + kFilterPadding ids.
+	// @return 	Number of kept ids.
+	template <typename Id>
+	size_t FilterRun (const Id* ids, const float* values, size_t n, float lo, float hi, Id* out);
+
+	// Count the candidates which position is in the box, as
+	// FilterIds without writing them anywhere.
+	// @return 	Number of candidates in the box.
+	template <typename Id>
+	size_t CountIds (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box);
+
+	// Count the coordinates in [lo, hi].
+	// @param[in]	values 	The coordinates.
+	// @param[in]	n 		Number of coordinates.
+	// @return 	Number of coordinates in [lo, hi].
+	size_t CountRun (const float* values, size_t n, float lo, float hi);
+
+	// The same as FilterIds without SIMD.
+	template <typename Id>
+	size_t FilterIdsScalar (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box, Id* out);
+
+	// The same as FilterRun without SIMD.
+	template <typename Id>
+	size_t FilterRunScalar (const Id* ids, const float* values, size_t n, float lo, float hi, Id* out);
+
+	// The same as CountIds without SIMD.
+	template <typename Id>
+	size_t CountIdsScalar (const Id* ids, size_t n, const float* xs, const float* ys, const FilterBox& box);
+
+	// The same as CountRun without SIMD.
+	size_t CountRunScalar (const float* values, size_t n, float lo, float hi);
+}
+
+#endif
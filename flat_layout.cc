@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////
+// @fileoverview Read-optimized flat form of a segment tree.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <algorithm>
+#include "flat_layout.h"
+
+using namespace ysd_bes_aoi;
+
+// region public method
+
+template <typename Id>
+void FlatLayout<Id>::Build (std::vector<float>& values, std::vector<Id>& ids)
+{
+	values_.swap(values);
+	ids_.swap(ids);
+
+	size_t n = values_.size();
+	eytzinger_.resize(n + 1);
+	ranks_.resize(n + 1);
+	BuildEytzinger(0, 1);
+}
+
+template <typename Id>
+void FlatLayout<Id>::Search (const float start, const float end, std::vector<Id>& result) const
+{
+	size_t n = values_.size();
+	for (size_t i = LowerBound(start); i < n && values_[i] <= end; ++i)
+	{
+		result.push_back(ids_[i]);
+	}
+}
+
+template <typename Id>
+size_t FlatLayout<Id>::LowerBound (const float value) const
+{
+	size_t n = values_.size();
+	size_t k = 1;
+	while (k <= n)
+	{
+		k = 2 * k + (eytzinger_[k] < value);
+	}
+	return Rank(k);
+}
+
+template <typename Id>
+size_t FlatLayout<Id>::UpperBound (const float value) const
+{
+	size_t n = values_.size();
+	size_t k = 1;
+	while (k <= n)
+	{
+		k = 2 * k + (eytzinger_[k] <= value);
+	}
+	return Rank(k);
+}
+
+template <typename Id>
+size_t FlatLayout<Id>::LowerBound (const float value, size_t from) const
+{
+	size_t n = values_.size();
+	size_t lo = from, hi = from, step = 1;
+
+	// Double the step until a leaf is not less than the value,
+	// then binary search the last step.
+	while (hi < n && values_[hi] < value)
+	{
+		lo = hi + 1;
+		hi = from + step;
+		step <<= 1;
+	}
+	hi = std::min(hi, n);
+	return std::lower_bound(values_.begin() + lo, values_.begin() + hi, value) - values_.begin();
+}
+
+template <typename Id>
+size_t FlatLayout<Id>::UpperBound (const float value, size_t from) const
+{
+	size_t n = values_.size();
+	size_t lo = from, hi = from, step = 1;
+	while (hi < n && values_[hi] <= value)
+	{
+		lo = hi + 1;
+		hi = from + step;
+		step <<= 1;
+	}
+	hi = std::min(hi, n);
+	return std::upper_bound(values_.begin() + lo, values_.begin() + hi, value) - values_.begin();
+}
+
+// endregion public method
+
+// region private method
+
+template <typename Id>
+size_t FlatLayout<Id>::Rank (size_t k) const
+{
+	// Go back up past the right turns, the last left turn is the answer.
+	while (k & 1)
+	{
+		k >>= 1;
+	}
+	k >>= 1;
+
+	return k == 0 ? values_.size() : ranks_[k];
+}
+
+template <typename Id>
+size_t FlatLayout<Id>::BuildEytzinger (size_t i, size_t k)
+{
+	if (k < eytzinger_.size())
+	{
+		i = BuildEytzinger(i, 2 * k);
+		eytzinger_[k] = values_[i];
+		ranks_[k] = i++;
+		i = BuildEytzinger(i, 2 * k + 1);
+	}
+	return i;
+}
+
+// endregion private method
+
+template class ysd_bes_aoi::FlatLayout<uint16_t>;
+template class ysd_bes_aoi::FlatLayout<uint32_t>;
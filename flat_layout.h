@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////
+// @fileoverview Read-optimized flat form of a segment tree.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _FLAT_LAYOUT_H_
+#define _FLAT_LAYOUT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// The leaves of a segment tree stored in sorted
+	// order as two parallel arrays (coordinates and ids),
+	// plus an Eytzinger (BFS ordered) copy of the
+	// coordinates to find the first leaf of a range.
+	// A range search is one branch-free descent over a
+	// contiguous array followed by a linear scan.
+	///////////////////////////////////////////////////
+	template <typename Id>
+	class FlatLayout final
+	{
+	public:
+
+		// Take the sorted leaves and build the search index.
+		// @param[in]	values 	Sorted X/Y coordinates, swapped out.
+		// @param[in]	ids 	Player ids in the same order, swapped out.
+		void Build (std::vector<float>& values, std::vector<Id>& ids);
+
+		// For a given range [start, end], get ids of
+		// those position that which X/Y coordinate in.
+		// @param[in]	start 	Search range.
+		// @param[in]	end 	Search range.
+		// @param[out]	result	Search result set.
+		void Search (const float start, const float end, std::vector<Id>& result) const;
+
+		// Number of leaves which X/Y coordinate in [start, end].
+		size_t Count (const float start, const float end) const
+		{
+			size_t first = LowerBound(start);
+			size_t last = UpperBound(end);
+			return last > first ? last - first : 0;
+		}
+
+		// Index of the first leaf which value is not less than the given value.
+		size_t LowerBound (const float value) const;
+
+		// Index of the first leaf which value is greater than the given value.
+		size_t UpperBound (const float value) const;
+
+		// LowerBound and UpperBound starting from a known index, by
+		// galloping forward. Fast when the answer is near, e.g. for
+		// queries sorted by start.
+		// @param[in]	from 	All leaves before it must be less
+		//						than (not greater than) the value.
+		size_t LowerBound (const float value, size_t from) const;
+		size_t UpperBound (const float value, size_t from) const;
+
+		size_t size ( ) const
+		{
+			return values_.size();
+		}
+
+		// Memory taken, in bytes.
+		size_t bytes ( ) const
+		{
+			return values_.capacity() * sizeof(float) + ids_.capacity() * sizeof(Id)
+			       + eytzinger_.capacity() * sizeof(float) + ranks_.capacity() * sizeof(uint32_t);
+		}
+
+		const float* values ( ) const
+		{
+			return values_.data();
+		}
+
+		const Id* ids ( ) const
+		{
+			return ids_.data();
+		}
+
+	private:
+
+		// Index of the first leaf the Eytzinger descent stops at.
+		// @param[in]	k 	Final index of the descent.
+		size_t Rank (size_t k) const;
+
+		// Fill the Eytzinger array from the sorted values in order.
+		// @param[in]	i 	Next sorted index to place.
+		// @param[in]	k 	Eytzinger index of the current subtree.
+		// @return 	Next sorted index to place.
+		size_t BuildEytzinger (size_t i, size_t k);
+
+		// Sorted X/Y coordinates of all leaves.
+		std::vector<float> values_;
+
+		// Player ids, in the same order of values_.
+		std::vector<Id> ids_;
+
+		// values_ in BFS order, 1-based.
+		std::vector<float> eytzinger_;
+
+		// Index into values_ of each entry of eytzinger_.
+		std::vector<uint32_t> ranks_;
+	};
+}
+
+#endif
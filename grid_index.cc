@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////
+// @fileoverview Defination of uniform grid index.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <math.h>
+#include <algorithm>
+#include "grid_index.h"
+
+using namespace ysd_bes_aoi;
+
+// Cell indexes are clamped to this, far beyond any real scene.
+static const float kMaxCell = 1 << 30;
+
+// region public method
+
+template <typename Id>
+void GridIndex<Id>::Insert (Id id, float x_pos, float y_pos)
+{
+	uint64_t key = CellKey(CellOf(x_pos), CellOf(y_pos));
+	std::vector<Entry>& cell = cells_[key];
+	slots_[id] = Slot{key, static_cast<uint32_t>(cell.size())};
+	cell.push_back(Entry{id, x_pos, y_pos});
+}
+
+template <typename Id>
+bool GridIndex<Id>::Remove (Id id)
+{
+	auto it = slots_.find(id);
+	if (it == slots_.end())
+	{
+		return false;
+	}
+	Erase(it->second);
+	slots_.erase(it);
+	return true;
+}
+
+template <typename Id>
+bool GridIndex<Id>::Update (Id id, float x_pos, float y_pos)
+{
+	auto it = slots_.find(id);
+	if (it == slots_.end())
+	{
+		return false;
+	}
+
+	Slot& slot = it->second;
+	uint64_t key = CellKey(CellOf(x_pos), CellOf(y_pos));
+	if (key == slot.cell)
+	{
+		// Still in the same cell, just change the position.
+		Entry& entry = cells_[key][slot.index];
+		entry.x_pos = x_pos;
+		entry.y_pos = y_pos;
+		return true;
+	}
+
+	Erase(slot);
+	std::vector<Entry>& cell = cells_[key];
+	slot.cell = key;
+	slot.index = static_cast<uint32_t>(cell.size());
+	cell.push_back(Entry{id, x_pos, y_pos});
+	return true;
+}
+
+template <typename Id>
+void GridIndex<Id>::Search (float x_start, float x_end, float y_start, float y_end, std::vector<Id>& result) const
+{
+	if (x_end < x_start || y_end < y_start)
+	{
+		return;
+	}
+
+	bool x_inclusive = x_end - x_start < y_end - y_start;
+	auto inside = [&] (const Entry & e)
+	{
+		if (x_inclusive)
+			return e.x_pos >= x_start && e.x_pos <= x_end && e.y_pos > y_start && e.y_pos < y_end;
+		return e.x_pos > x_start && e.x_pos < x_end && e.y_pos >= y_start && e.y_pos <= y_end;
+	};
+
+	int32_t cx0 = CellOf(x_start), cx1 = CellOf(x_end);
+	int32_t cy0 = CellOf(y_start), cy1 = CellOf(y_end);
+	// Widths in 64 bits, cells are clamped to +-2^30, so an
+	// unbounded range is 2^31 + 1 cells wide.
+	uint64_t covered = static_cast<uint64_t>(int64_t(cx1) - cx0 + 1) * static_cast<uint64_t>(int64_t(cy1) - cy0 + 1);
+
+	if (covered > cells_.size())
+	{
+		// The range covers more cells than there are players' cells.
+		for (const auto& kv : cells_)
+		{
+			for (const Entry& e : kv.second)
+			{
+				if (inside(e))
+					result.push_back(e.id);
+			}
+		}
+		return;
+	}
+
+	for (int32_t cx = cx0; cx <= cx1; ++cx)
+	{
+		for (int32_t cy = cy0; cy <= cy1; ++cy)
+		{
+			auto it = cells_.find(CellKey(cx, cy));
+			if (it == cells_.end())
+			{
+				continue;
+			}
+
+			if (cx > cx0 && cx < cx1 && cy > cy0 && cy < cy1)
+			{
+				// An inner cell is strictly inside the range.
+				for (const Entry& e : it->second)
+				{
+					result.push_back(e.id);
+				}
+				continue;
+			}
+
+			for (const Entry& e : it->second)
+			{
+				if (inside(e))
+					result.push_back(e.id);
+			}
+		}
+	}
+}
+
+// endregion public method
+
+// region private method
+
+template <typename Id>
+int32_t GridIndex<Id>::CellOf (float pos) const
+{
+	float c = floorf(pos * inv_cell_size_);
+	return static_cast<int32_t>(std::max(-kMaxCell, std::min(kMaxCell, c)));
+}
+
+template <typename Id>
+void GridIndex<Id>::Erase (const Slot& slot)
+{
+	auto it = cells_.find(slot.cell);
+	std::vector<Entry>& cell = it->second;
+
+	// Move the last player of the cell into the hole.
+	if (slot.index + 1 != cell.size())
+	{
+		cell[slot.index] = cell.back();
+		slots_[cell[slot.index].id].index = slot.index;
+	}
+	cell.pop_back();
+
+	if (cell.empty())
+	{
+		cells_.erase(it);
+	}
+}
+
+// endregion private method
+
+template class ysd_bes_aoi::GridIndex<uint16_t>;
+template class ysd_bes_aoi::GridIndex<uint32_t>;
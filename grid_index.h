@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////
+// @fileoverview Defination of uniform grid index.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _GRID_INDEX_H_
+#define _GRID_INDEX_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// Spatial hash of square cells to manage a 2d game
+	// scene. Every cell keeps the ids and positions of
+	// the players in it, so a search only reads the
+	// cells the range covers, and a move inside a cell
+	// is O(1). Works best with a fixed view range and
+	// a cell size close to it.
+	///////////////////////////////////////////////////
+	template <typename Id>
+	class GridIndex final
+	{
+	public:
+
+		// @param[in]	cell_size 	Width and height of a cell.
+		explicit GridIndex (float cell_size) :
+			cell_size_ (cell_size), inv_cell_size_ (1.0f / cell_size)
+		{
+
+		}
+
+		GridIndex (const GridIndex&) = delete;
+		GridIndex& operator= (const GridIndex&) = delete;
+
+		// Insert a player. The id must not be in the grid.
+		void Insert (Id id, float x_pos, float y_pos);
+
+		// Remove a player.
+		// @return 	False if the id is not in the grid.
+		bool Remove (Id id);
+
+		// Move a player.
+		// @return 	False if the id is not in the grid.
+		bool Update (Id id, float x_pos, float y_pos);
+
+		// Search players in a given square range. Like the scene's
+		// tree search, the shorter axis of the range is tested with
+		// inclusive bounds, the longer one with exclusive bounds.
+		// @param[out]	result	Search result set.
+		void Search (float x_start, float x_end, float y_start, float y_end, std::vector<Id>& result) const;
+
+		// Remove all players and give the memory back.
+		void Clear ( )
+		{
+			std::unordered_map<uint64_t, std::vector<Entry>>().swap(cells_);
+			std::unordered_map<Id, Slot>().swap(slots_);
+		}
+
+		float cell_size ( ) const
+		{
+			return cell_size_;
+		}
+
+	private:
+
+		// A player in a cell.
+		struct Entry
+		{
+			Id id;
+			float x_pos;
+			float y_pos;
+		};
+
+		// Where a player is stored.
+		struct Slot
+		{
+			uint64_t cell;
+			uint32_t index;
+		};
+
+		// Index of the cell along an axis.
+		int32_t CellOf (float pos) const;
+
+		// Key of a cell in cells_.
+		static uint64_t CellKey (int32_t cx, int32_t cy)
+		{
+			return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+		}
+
+		// Remove the entry in the slot from its cell.
+		void Erase (const Slot& slot);
+
+		float cell_size_;
+		float inv_cell_size_;
+
+		// Players of every non-empty cell.
+		std::unordered_map<uint64_t, std::vector<Entry>> cells_;
+
+		// Cell and index in cell of every player.
+		std::unordered_map<Id, Slot> slots_;
+	};
+}
+
+#endif
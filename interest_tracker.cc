@@ -0,0 +1,306 @@
+//////////////////////////////////////////////////
+// @fileoverview Incremental enter/leave events of aoi.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <algorithm>
+#include "interest_tracker.h"
+#include "scene.h"
+
+using namespace ysd_bes_aoi;
+
+// region public method
+
+template <typename Id>
+void InterestTracker<Id>::Watch (Id subscriber, float x_start, float x_end, float y_start, float y_end)
+{
+	auto res = watchers_.emplace(subscriber, Watcher());
+	Watcher& w = res.first->second;
+	if (!res.second && !w.dirty && w.x_start == x_start && w.x_end == x_end && w.y_start == y_start && w.y_end == y_end)
+	{
+		return;
+	}
+	w.x_start = x_start;
+	w.x_end = x_end;
+	w.y_start = y_start;
+	w.y_end = y_end;
+	w.dirty = true;
+	index_valid_ = false;
+}
+
+template <typename Id>
+bool InterestTracker<Id>::Unwatch (Id subscriber)
+{
+	auto it = watchers_.find(subscriber);
+	if (it == watchers_.end())
+	{
+		return false;
+	}
+
+	for (Id id : it->second.visible)
+	{
+		auto p = seen_by_.find(id);
+		std::vector<Id>& subscribers = p->second;
+		subscribers.erase(std::find(subscribers.begin(), subscribers.end(), subscriber));
+		if (subscribers.empty())
+		{
+			seen_by_.erase(p);
+		}
+	}
+	watchers_.erase(it);
+	index_valid_ = false;
+
+	if (watchers_.empty())
+	{
+		Clear();
+	}
+	return true;
+}
+
+template <typename Id>
+void InterestTracker<Id>::Reset ( )
+{
+	for (auto& kv : watchers_)
+	{
+		kv.second.dirty = true;
+	}
+	moved_.clear();
+	removed_.clear();
+}
+
+template <typename Id>
+void InterestTracker<Id>::Collect (Scene& scene, std::vector<Id>& enter, std::vector<Id>& leave)
+{
+	enter.clear();
+	leave.clear();
+
+	// Removed players leave every subscriber.
+	for (Id id : removed_)
+	{
+		auto it = seen_by_.find(id);
+		if (it == seen_by_.end())
+		{
+			continue;
+		}
+		scratch_ids_ = it->second;
+		for (Id subscriber : scratch_ids_)
+		{
+			Unsee(subscriber, watchers_[subscriber], id, leave);
+		}
+	}
+	removed_.clear();
+
+	// Subscribers which range changed search the scene again.
+	for (auto& kv : watchers_)
+	{
+		Watcher& w = kv.second;
+		if (!w.dirty)
+		{
+			continue;
+		}
+		w.dirty = false;
+
+		const std::vector<Id>& hits = scene.Search(w.x_start, w.x_end, w.y_start, w.y_end);
+		std::unordered_set<Id> now(hits.begin(), hits.end());
+
+		scratch_ids_.clear();
+		for (Id id : w.visible)
+		{
+			if (now.count(id) == 0)
+				scratch_ids_.push_back(id);
+		}
+		for (Id id : scratch_ids_)
+		{
+			Unsee(kv.first, w, id, leave);
+		}
+		for (Id id : now)
+		{
+			if (w.visible.count(id) == 0)
+				See(kv.first, w, id, enter);
+		}
+	}
+
+	// Moved players, sorted by x.
+	scratch_ids_.clear();
+	scratch_xs_.clear();
+	scratch_ys_.clear();
+	for (Id id : moved_)
+	{
+		float x, y;
+		if (scene.Position(id, &x, &y))
+		{
+			scratch_ids_.push_back(id);
+			scratch_xs_.push_back(x);
+			scratch_ys_.push_back(y);
+		}
+	}
+	moved_.clear();
+
+	size_t n = scratch_ids_.size();
+	if (n == 0)
+	{
+		return;
+	}
+
+	// Moved players leave the subscribers that can not see them now.
+	std::vector<Id> subscribers;
+	for (size_t i = 0; i < n; ++i)
+	{
+		auto it = seen_by_.find(scratch_ids_[i]);
+		if (it == seen_by_.end())
+		{
+			continue;
+		}
+		subscribers = it->second;
+		for (Id subscriber : subscribers)
+		{
+			Watcher& w = watchers_[subscriber];
+			if (!Scene::InRange(w.x_start, w.x_end, w.y_start, w.y_end, scratch_xs_[i], scratch_ys_[i]))
+				Unsee(subscriber, w, scratch_ids_[i], leave);
+		}
+	}
+
+	// Every moved player looks up the ranges that may hold it, so
+	// subscribers no moved player is near are not looked at.
+	if (!index_valid_)
+	{
+		BuildIndex();
+	}
+	size_t candidates = 0;
+	scratch_spans_.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		double x = scratch_xs_[i];
+		auto first = std::lower_bound(ranges_.begin(), ranges_.end(), x - max_width_, [] (const std::pair<float, Id>& r, double start)
+		{
+			return r.first < start;
+		});
+		auto last = std::upper_bound(first, ranges_.end(), x, [] (double start, const std::pair<float, Id>& r)
+		{
+			return start < r.first;
+		});
+		scratch_spans_[i] = std::make_pair(first - ranges_.begin(), last - ranges_.begin());
+		candidates += last - first;
+	}
+
+	// A few wide ranges make every moved player a candidate of most
+	// subscribers. Then every subscriber looks up the moved players
+	// in its x range instead, which is never worse than W log M.
+	size_t log_n = 64 - __builtin_clzll(n);
+	if (candidates <= watchers_.size() * log_n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			Id id = scratch_ids_[i];
+			for (uint32_t r = scratch_spans_[i].first; r < scratch_spans_[i].second; ++r)
+			{
+				Id subscriber = ranges_[r].second;
+				Watcher& w = watchers_[subscriber];
+				if (Scene::InRange(w.x_start, w.x_end, w.y_start, w.y_end, scratch_xs_[i], scratch_ys_[i])
+				        && w.visible.count(id) == 0)
+				{
+					See(subscriber, w, id, enter);
+				}
+			}
+		}
+		return;
+	}
+
+	scratch_order_.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		scratch_order_[i] = i;
+	}
+	std::sort(scratch_order_.begin(), scratch_order_.end(), [this] (uint32_t a, uint32_t b)
+	{
+		return scratch_xs_[a] < scratch_xs_[b];
+	});
+	for (auto& kv : watchers_)
+	{
+		Watcher& w = kv.second;
+		auto first = std::lower_bound(scratch_order_.begin(), scratch_order_.end(), w.x_start, [this] (uint32_t a, float x)
+		{
+			return scratch_xs_[a] < x;
+		});
+		for (auto p = first; p != scratch_order_.end() && scratch_xs_[*p] <= w.x_end; ++p)
+		{
+			Id id = scratch_ids_[*p];
+			if (Scene::InRange(w.x_start, w.x_end, w.y_start, w.y_end, scratch_xs_[*p], scratch_ys_[*p])
+			        && w.visible.count(id) == 0)
+			{
+				See(kv.first, w, id, enter);
+			}
+		}
+	}
+}
+
+template <typename Id>
+void InterestTracker<Id>::Clear ( )
+{
+	std::unordered_map<Id, Watcher>().swap(watchers_);
+	std::unordered_map<Id, std::vector<Id>>().swap(seen_by_);
+	std::unordered_set<Id>().swap(moved_);
+	std::vector<Id>().swap(removed_);
+	std::vector<std::pair<float, Id>>().swap(ranges_);
+	max_width_ = 0;
+	index_valid_ = false;
+}
+
+// endregion public method
+
+// region private method
+
+template <typename Id>
+void InterestTracker<Id>::BuildIndex ( )
+{
+	ranges_.clear();
+	max_width_ = 0;
+	for (const auto& kv : watchers_)
+	{
+		const Watcher& w = kv.second;
+
+		// In double, so the start of the widest range minus its width
+		// is not rounded past a position it holds.
+		double width = static_cast<double>(w.x_end) - w.x_start;
+		if (width >= 0 && w.y_end >= w.y_start)
+		{
+			ranges_.push_back(std::make_pair(w.x_start, kv.first));
+			max_width_ = std::max(max_width_, width);
+		}
+	}
+	std::sort(ranges_.begin(), ranges_.end());
+	index_valid_ = true;
+}
+
+template <typename Id>
+void InterestTracker<Id>::See (Id subscriber, Watcher& w, Id id, std::vector<Id>& enter)
+{
+	w.visible.insert(id);
+	seen_by_[id].push_back(subscriber);
+	enter.push_back(subscriber);
+	enter.push_back(id);
+}
+
+template <typename Id>
+void InterestTracker<Id>::Unsee (Id subscriber, Watcher& w, Id id, std::vector<Id>& leave)
+{
+	w.visible.erase(id);
+
+	auto it = seen_by_.find(id);
+	std::vector<Id>& subscribers = it->second;
+	auto p = std::find(subscribers.begin(), subscribers.end(), subscriber);
+	*p = subscribers.back();
+	subscribers.pop_back();
+	if (subscribers.empty())
+	{
+		seen_by_.erase(it);
+	}
+
+	leave.push_back(subscriber);
+	leave.push_back(id);
+}
+
+// endregion private method
+
+// Collect searches the scene, so only the scene's id type is supported.
+template class ysd_bes_aoi::InterestTracker<AoiId>;
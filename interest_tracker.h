@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////
+// @fileoverview Incremental enter/leave events of aoi.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _INTEREST_TRACKER_H_
+#define _INTEREST_TRACKER_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	class Scene;
+
+	///////////////////////////////////////////////////
+	// Keeps a watch range for every subscriber and the
+	// players each of them sees. Instead of searching
+	// again for every subscriber each tick, Collect only
+	// looks at the players that moved and the ranges
+	// that changed since the last call.
+	///////////////////////////////////////////////////
+	template <typename Id>
+	class InterestTracker final
+	{
+	public:
+
+		// If there is any subscriber, so changes must be recorded.
+		bool active ( ) const
+		{
+			return !watchers_.empty();
+		}
+
+		// Set the watch range of a subscriber, adding it if needed.
+		void Watch (Id subscriber, float x_start, float x_end, float y_start, float y_end);
+
+		// Remove a subscriber. No leave events are made for it.
+		// @return 	False if it is not a subscriber.
+		bool Unwatch (Id subscriber);
+
+		// Record that a player is inserted or moved.
+		void Moved (Id id)
+		{
+			moved_.insert(id);
+		}
+
+		// Record that a player is removed.
+		void Removed (Id id)
+		{
+			moved_.erase(id);
+			removed_.push_back(id);
+		}
+
+		// Everything may have changed, e.g. after a load.
+		void Reset ( );
+
+		// Work out what every subscriber sees now, and how it
+		// changed since the last call.
+		// @param[in]	scene 	The scene the players are in.
+		// @param[out]	enter 	(subscriber, player) pairs, flattened.
+		// @param[out]	leave 	(subscriber, player) pairs, flattened.
+		void Collect (Scene& scene, std::vector<Id>& enter, std::vector<Id>& leave);
+
+		// Remove all subscribers and give the memory back.
+		void Clear ( );
+
+	private:
+
+		// A subscriber.
+		struct Watcher
+		{
+			float x_start;
+			float x_end;
+			float y_start;
+			float y_end;
+
+			// If the range changed since the last Collect.
+			bool dirty;
+
+			// Players in the range at the last Collect.
+			std::unordered_set<Id> visible;
+		};
+
+		// Sort the watch ranges by start into ranges_.
+		void BuildIndex ( );
+
+		// Make the pair (subscriber, id) see each other or not.
+		void See (Id subscriber, Watcher& w, Id id, std::vector<Id>& enter);
+		void Unsee (Id subscriber, Watcher& w, Id id, std::vector<Id>& leave);
+
+		std::unordered_map<Id, Watcher> watchers_;
+
+		// Subscribers that see every player.
+		std::unordered_map<Id, std::vector<Id>> seen_by_;
+
+		// Players inserted or moved since the last Collect.
+		std::unordered_set<Id> moved_;
+
+		// Players removed since the last Collect.
+		std::vector<Id> removed_;
+
+		// Start of the watch ranges on x and their subscriber, sorted
+		// by start. A range holding x starts in [x - max_width_, x],
+		// so a moved player only looks at the ranges starting there.
+		// Empty ranges and ones with NaN bounds are left out.
+		std::vector<std::pair<float, Id>> ranges_;
+		double max_width_ = 0;
+
+		// If ranges_ matches the watch ranges.
+		bool index_valid_ = false;
+
+		// Scratch buffers of Collect.
+		std::vector<Id> scratch_ids_;
+		std::vector<float> scratch_xs_;
+		std::vector<float> scratch_ys_;
+		std::vector<uint32_t> scratch_order_;
+		std::vector<std::pair<uint32_t, uint32_t>> scratch_spans_;
+	};
+}
+
+#endif
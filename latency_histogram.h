@@ -0,0 +1,165 @@
+//////////////////////////////////////////////////
+// @fileoverview Log-linear histogram of call latency.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _LATENCY_HISTOGRAM_H_
+#define _LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// Counts of latencies in nanoseconds. Every power
+	// of two is split into kSubBuckets linear buckets,
+	// so a percentile is off by at most 1/kSubBuckets
+	// of its value, as HdrHistogram does. Recording is
+	// a few relaxed atomic adds, no lock, so it can stay
+	// on in live servers and be read from any thread.
+	///////////////////////////////////////////////////
+	class LatencyHistogram final
+	{
+	public:
+
+		// Linear buckets in every power of two.
+		static const int kSubBits = 4;
+		static const uint64_t kSubBuckets = 1 << kSubBits;
+
+		// Latencies from 2^kMaxBits ns, about 18 minutes,
+		// are counted in the last bucket.
+		static const int kMaxBits = 40;
+		static const size_t kBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+		LatencyHistogram ( )
+		{
+			Reset();
+		}
+
+		LatencyHistogram (const LatencyHistogram&) = delete;
+		LatencyHistogram& operator= (const LatencyHistogram&) = delete;
+
+		// Current time in nanoseconds, from a monotonic clock.
+		static uint64_t Now ( )
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			           std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// Count a latency.
+		// @param[in]	ns 	The latency in nanoseconds.
+		void Record (uint64_t ns)
+		{
+			buckets_[Index(ns)].fetch_add(1, std::memory_order_relaxed);
+			count_.fetch_add(1, std::memory_order_relaxed);
+			sum_.fetch_add(ns, std::memory_order_relaxed);
+			uint64_t max = max_.load(std::memory_order_relaxed);
+			while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			{
+
+			}
+		}
+
+		// Latency which p of the counted ones are not over.
+		// @param[in]	p 	In [0, 1].
+		// @return 	Upper bound of the bucket the latency falls in,
+		//			but not more than the max. 0 if nothing is counted.
+		uint64_t Percentile (double p) const
+		{
+			uint64_t count = count_.load(std::memory_order_relaxed);
+			if (count == 0)
+			{
+				return 0;
+			}
+			uint64_t rank = static_cast<uint64_t>(p * count + 0.5);
+			rank = rank < 1 ? 1 : rank > count ? count : rank;
+
+			uint64_t seen = 0;
+			for (size_t i = 0; i < kBuckets; ++i)
+			{
+				seen += buckets_[i].load(std::memory_order_relaxed);
+				if (seen >= rank)
+				{
+					uint64_t upper = UpperBound(i);
+					uint64_t max = this->max();
+					return upper < max ? upper : max;
+				}
+			}
+			// Records made while walking the buckets.
+			return max();
+		}
+
+		// Number of latencies counted.
+		uint64_t count ( ) const
+		{
+			return count_.load(std::memory_order_relaxed);
+		}
+
+		// Sum of the latencies counted.
+		uint64_t sum ( ) const
+		{
+			return sum_.load(std::memory_order_relaxed);
+		}
+
+		// The longest latency counted.
+		uint64_t max ( ) const
+		{
+			return max_.load(std::memory_order_relaxed);
+		}
+
+		// Forget all latencies counted.
+		void Reset ( )
+		{
+			for (auto& bucket : buckets_)
+			{
+				bucket.store(0, std::memory_order_relaxed);
+			}
+			count_.store(0, std::memory_order_relaxed);
+			sum_.store(0, std::memory_order_relaxed);
+			max_.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+
+		// Bucket of a latency: latencies under kSubBuckets have one
+		// bucket each, a bigger one goes by its highest bit and the
+		// kSubBits bits after it.
+		static size_t Index (uint64_t ns)
+		{
+			if (ns < kSubBuckets)
+			{
+				return static_cast<size_t>(ns);
+			}
+			int top = 63 - __builtin_clzll(ns);
+			if (top >= kMaxBits)
+			{
+				return kBuckets - 1;
+			}
+			int shift = top - kSubBits;
+			return static_cast<size_t>((shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets));
+		}
+
+		// The biggest latency of a bucket.
+		static uint64_t UpperBound (size_t index)
+		{
+			if (index < kSubBuckets)
+			{
+				return index;
+			}
+			int shift = static_cast<int>(index / kSubBuckets) - 1;
+			uint64_t sub = kSubBuckets + index % kSubBuckets;
+			return ((sub + 1) << shift) - 1;
+		}
+
+		std::atomic<uint64_t> buckets_[kBuckets];
+		std::atomic<uint64_t> count_;
+		std::atomic<uint64_t> sum_;
+		std::atomic<uint64_t> max_;
+	};
+}
+
+#endif
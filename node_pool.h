@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////
+// @fileoverview Slab allocator for tree nodes.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _NODE_POOL_H_
+#define _NODE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	// Slot of a node in a NodePool.
+	typedef uint32_t NodeIndex;
+
+	// No node, as nullptr for a pointer.
+	const NodeIndex kNoNode = 0xffffffff;
+
+	///////////////////////////////////////////////////
+	// A free-list arena of fixed size nodes.
+	// Nodes are carved out of slabs of 1 << kSlabBits
+	// nodes that are never moved, and named by a 32 bit
+	// slot index that stays valid until the pool is
+	// reset. Freed slots go to a free list and are
+	// handed out again first, so a tree of stable size
+	// does not touch the allocator.
+	///////////////////////////////////////////////////
+	template <typename T, size_t kSlabBits = 9>
+	class NodePool final
+	{
+	public:
+
+		static const size_t kSlabSize = size_t(1) << kSlabBits;
+
+		NodePool ( ) :
+			slab_index_ (0), slab_used_ (kSlabSize), live_ (0)
+		{
+
+		}
+
+		~NodePool ( )
+		{
+			Release();
+		}
+
+		NodePool (const NodePool&) = delete;
+		NodePool& operator= (const NodePool&) = delete;
+
+		// Get the slot of a default constructed node.
+		NodeIndex Alloc ( )
+		{
+			++live_;
+			if (!free_.empty())
+			{
+				NodeIndex i = free_.back();
+				free_.pop_back();
+				Get(i) = T();
+				return i;
+			}
+
+			if (slab_used_ == kSlabSize)
+			{
+				// Current slab is full, move to the next one.
+				if (slab_index_ + 1 < slabs_.size())
+				{
+					// Reuse a slab kept by Reset.
+					++slab_index_;
+				}
+				else
+				{
+					slabs_.push_back(new T[kSlabSize]);
+					slab_index_ = slabs_.size() - 1;
+				}
+				slab_used_ = 0;
+			}
+
+			NodeIndex i = NodeIndex((slab_index_ << kSlabBits) + slab_used_++);
+			Get(i) = T();
+			return i;
+		}
+
+		// Give a node back to the pool.
+		void Free (NodeIndex i)
+		{
+			--live_;
+			free_.push_back(i);
+		}
+
+		// The node in a slot.
+		T& Get (NodeIndex i)
+		{
+			return slabs_[i >> kSlabBits][i & (kSlabSize - 1)];
+		}
+
+		const T& Get (NodeIndex i) const
+		{
+			return slabs_[i >> kSlabBits][i & (kSlabSize - 1)];
+		}
+
+		// Drop every node at once. Slabs are kept for reuse.
+		void Reset ( )
+		{
+			free_.clear();
+			slab_index_ = 0;
+			slab_used_ = slabs_.empty() ? kSlabSize : 0;
+			live_ = 0;
+		}
+
+		// Drop every node and free the slabs.
+		void Release ( )
+		{
+			for (T* slab : slabs_)
+			{
+				delete[] slab;
+			}
+			std::vector<T*>().swap(slabs_);
+			std::vector<NodeIndex>().swap(free_);
+			slab_index_ = 0;
+			slab_used_ = kSlabSize;
+			live_ = 0;
+		}
+
+		// Number of nodes handed out and not freed.
+		size_t live ( ) const
+		{
+			return live_;
+		}
+
+		// Number of nodes the slabs can hold.
+		size_t capacity ( ) const
+		{
+			return slabs_.size() * kSlabSize;
+		}
+
+	private:
+
+		// Every slab allocated so far.
+		std::vector<T*> slabs_;
+
+		// Slots that have been freed and can be reused.
+		std::vector<NodeIndex> free_;
+
+		// The slab new nodes are carved from.
+		size_t slab_index_;
+
+		// Number of nodes used in the current slab.
+		size_t slab_used_;
+
+		size_t live_;
+	};
+
+	template <typename T, size_t kSlabBits>
+	const size_t NodePool<T, kSlabBits>::kSlabSize;
+}
+
+#endif
@@ -0,0 +1,218 @@
+//////////////////////////////////////////////////
+// @fileoverview Dense position store indexed by player id.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _POSITION_STORE_H_
+#define _POSITION_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// X/Y coordinates of players as two arrays indexed
+	// by id, plus a bitmap of the ids in use. A lookup
+	// is two array reads instead of hashing and chasing
+	// a node, and a filter pass over search candidates
+	// reads linear memory. Ids are expected to be small
+	// integers; the arrays grow to the biggest id used.
+	///////////////////////////////////////////////////
+	class PositionStore final
+	{
+	public:
+
+		// Ids must be less than this, so a stray big id can
+		// not make the arrays take gigabytes.
+		static const size_t kMaxIds = 1 << 24;
+
+		PositionStore ( ) :
+			size_ (0)
+		{
+
+		}
+
+		PositionStore (const PositionStore&) = delete;
+		PositionStore& operator= (const PositionStore&) = delete;
+
+		// Add a player.
+		// @return 	False if the id is in use or not less than kMaxIds.
+		bool Insert (size_t id, float x_pos, float y_pos)
+		{
+			if (id >= kMaxIds || Contains(id))
+			{
+				return false;
+			}
+			if (id >= xs_.size())
+			{
+				Grow(id + 1);
+			}
+			xs_[id] = x_pos;
+			ys_[id] = y_pos;
+			alive_[id >> 6] |= uint64_t(1) << (id & 63);
+			++size_;
+			return true;
+		}
+
+		// Remove a player.
+		// @return 	False if the id is not in use.
+		bool Remove (size_t id)
+		{
+			if (!Contains(id))
+			{
+				return false;
+			}
+			alive_[id >> 6] &= ~(uint64_t(1) << (id & 63));
+			--size_;
+			return true;
+		}
+
+		// Move a player.
+		// @return 	False if the id is not in use.
+		bool Set (size_t id, float x_pos, float y_pos)
+		{
+			if (!Contains(id))
+			{
+				return false;
+			}
+			xs_[id] = x_pos;
+			ys_[id] = y_pos;
+			return true;
+		}
+
+		// Get the position of a player.
+		// @return 	False if the id is not in use.
+		bool Get (size_t id, float* x_pos, float* y_pos) const
+		{
+			if (!Contains(id))
+			{
+				return false;
+			}
+			*x_pos = xs_[id];
+			*y_pos = ys_[id];
+			return true;
+		}
+
+		bool Contains (size_t id) const
+		{
+			return id < xs_.size() && (alive_[id >> 6] >> (id & 63)) & 1;
+		}
+
+		// Call f(id, x_pos, y_pos) for every player, by id.
+		template <typename F>
+		void ForEach (F f) const
+		{
+			for (size_t w = 0; w < alive_.size(); ++w)
+			{
+				for (uint64_t bits = alive_[w]; bits != 0; bits &= bits - 1)
+				{
+					size_t id = (w << 6) + __builtin_ctzll(bits);
+					f(id, xs_[id], ys_[id]);
+				}
+			}
+		}
+
+		// Number of players.
+		size_t size ( ) const
+		{
+			return size_;
+		}
+
+		// X coordinates, indexed by id. Only valid for ids in use.
+		const float* xs ( ) const
+		{
+			return xs_.data();
+		}
+
+		// Y coordinates, indexed by id. Only valid for ids in use.
+		const float* ys ( ) const
+		{
+			return ys_.data();
+		}
+
+		// Bitmap of the ids in use, one bit for every id.
+		const uint64_t* alive ( ) const
+		{
+			return alive_.data();
+		}
+
+		// Ids the arrays have room for, all ids in use are less.
+		size_t capacity ( ) const
+		{
+			return xs_.size();
+		}
+
+		// Replace all players with a copy of the arrays of another
+		// store, e.g. read from a file.
+		// @param[in]	xs, ys 	X/Y coordinates, indexed by id.
+		// @param[in]	alive 	Bitmap of the ids in use, (n + 63) / 64 words.
+		// @param[in]	n 		Length of xs and ys, not more than kMaxIds.
+		void Assign (const float* xs, const float* ys, const uint64_t* alive, size_t n)
+		{
+			xs_.assign(xs, xs + n);
+			ys_.assign(ys, ys + n);
+			alive_.assign(alive, alive + ((n + 63) >> 6));
+			if (n & 63)
+			{
+				alive_.back() &= (uint64_t(1) << (n & 63)) - 1;
+			}
+			size_ = 0;
+			for (uint64_t bits : alive_)
+			{
+				size_ += __builtin_popcountll(bits);
+			}
+		}
+
+		void Swap (PositionStore& other)
+		{
+			xs_.swap(other.xs_);
+			ys_.swap(other.ys_);
+			alive_.swap(other.alive_);
+			std::swap(size_, other.size_);
+		}
+
+		// Remove all players. Memory is kept for reuse.
+		void Clear ( )
+		{
+			std::fill(alive_.begin(), alive_.end(), 0);
+			size_ = 0;
+		}
+
+		// Remove all players and give the memory back.
+		void Release ( )
+		{
+			std::vector<float>().swap(xs_);
+			std::vector<float>().swap(ys_);
+			std::vector<uint64_t>().swap(alive_);
+			size_ = 0;
+		}
+
+	private:
+
+		// Make room for ids less than n, at least doubling.
+		void Grow (size_t n)
+		{
+			// Not std::min, which would take kMaxIds by reference.
+			n = std::max(n, 2 * xs_.size());
+			n = n < kMaxIds ? n : kMaxIds;
+			xs_.resize(n);
+			ys_.resize(n);
+			alive_.resize((n + 63) >> 6);
+		}
+
+		std::vector<float> xs_;
+		std::vector<float> ys_;
+
+		// One bit for every id, set if the id is in use.
+		std::vector<uint64_t> alive_;
+
+		// Number of ids in use.
+		size_t size_;
+	};
+}
+
+#endif
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////
+// @fileoverview Radix sort of coordinates with ids.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _RADIX_SORT_H_
+#define _RADIX_SORT_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	// Map a float to an unsigned key with the same order.
+	inline uint32_t FloatKey (float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		// Flip all bits of negative numbers, only the sign bit of the others.
+		return bits ^ (-(int32_t)(bits >> 31) | 0x80000000u);
+	}
+
+	///////////////////////////////////////////////////
+	// Sort values ascending and carry ids along, with
+	// an LSD radix sort of four 8 bit passes. Stable,
+	// O(n), and does not compare floats.
+	// @param[in, out]	values 	Coordinates to sort.
+	// @param[in, out]	ids 	Ids in the same order of values.
+	///////////////////////////////////////////////////
+	template <typename Id>
+	void RadixSort (std::vector<float>& values, std::vector<Id>& ids)
+	{
+		size_t n = values.size();
+		if (n < 2)
+		{
+			return;
+		}
+
+		std::vector<uint32_t> keys(n), keys_tmp(n);
+		std::vector<Id> ids_tmp(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			keys[i] = FloatKey(values[i]);
+		}
+
+		std::vector<float> values_tmp(n);
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			size_t count[257] = {0};
+			for (size_t i = 0; i < n; ++i)
+			{
+				++count[((keys[i] >> shift) & 0xff) + 1];
+			}
+
+			// All keys have the same byte, this pass changes nothing.
+			if (count[((keys[0] >> shift) & 0xff) + 1] == n)
+			{
+				continue;
+			}
+
+			for (int b = 0; b < 256; ++b)
+			{
+				count[b + 1] += count[b];
+			}
+			for (size_t i = 0; i < n; ++i)
+			{
+				size_t to = count[(keys[i] >> shift) & 0xff]++;
+				keys_tmp[to] = keys[i];
+				values_tmp[to] = values[i];
+				ids_tmp[to] = ids[i];
+			}
+			keys.swap(keys_tmp);
+			values.swap(values_tmp);
+			ids.swap(ids_tmp);
+		}
+	}
+}
+
+#endif
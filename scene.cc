@@ -0,0 +1,676 @@
+//////////////////////////////////////////////////
+// @fileoverview Defination of an aoi scene.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <math.h>
+#include <algorithm>
+#include "scene.h"
+
+using namespace ysd_bes_aoi;
+
+// Sort the players by one coordinate into a flat layout.
+// @param[in]	on_y 	If by y coordinate.
+static void SortedFlat (const PositionStore& positions, bool on_y, FlatLayout<AoiId>& flat)
+{
+	std::vector<float> values;
+	std::vector<AoiId> ids;
+	values.reserve(positions.size());
+	ids.reserve(positions.size());
+	positions.ForEach([&] (size_t id, float x_pos, float y_pos)
+	{
+		ids.push_back(id);
+		values.push_back(on_y ? y_pos : x_pos);
+	});
+	RadixSort(values, ids);
+	flat.Build(values, ids);
+}
+
+// region public method
+
+const size_t Scene::kParallelBatch;
+
+bool Scene::Insert (AoiId id, float x_pos, float y_pos)
+{
+	if (!positions_.Insert(id, x_pos, y_pos))
+	{
+		return false;
+	}
+	view_.reset();
+	if (tracker_.active())
+	{
+		tracker_.Moved(id);
+	}
+	if (grid_)
+	{
+		grid_->Insert(id, x_pos, y_pos);
+		return true;
+	}
+	others_valid_ = false;
+	x_tree_.Insert(id, x_pos);
+	y_tree_.Insert(id, y_pos);
+	return true;
+}
+
+bool Scene::Remove (AoiId id)
+{
+	if (!positions_.Remove(id))
+	{
+		return false;
+	}
+	others_valid_ = false;
+	view_.reset();
+	bool v = grid_ ? grid_->Remove(id) : x_tree_.Remove(id) && y_tree_.Remove(id);
+	if (tracker_.active())
+	{
+		tracker_.Removed(id);
+	}
+	return v;
+}
+
+bool Scene::Update (AoiId id, float x_pos, float y_pos)
+{
+	if (!positions_.Set(id, x_pos, y_pos))
+	{
+		return false;
+	}
+	others_valid_ = false;
+	view_.reset();
+	bool v = grid_ ? grid_->Update(id, x_pos, y_pos) : x_tree_.Update(id, x_pos) && y_tree_.Update(id, y_pos);
+	if (tracker_.active())
+	{
+		tracker_.Moved(id);
+	}
+	return v;
+}
+
+void Scene::InsertMany (const AoiId* ids, const float* xs, const float* ys, size_t n,
+                        std::vector<uint8_t>& done, WorkerPool* pool)
+{
+	done.assign(n, 0);
+	if (grid_)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			done[i] = Insert(ids[i], xs[i], ys[i]);
+		}
+		return;
+	}
+
+	batch_.clear();
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (positions_.Insert(ids[i], xs[i], ys[i]))
+		{
+			done[i] = 1;
+			batch_.push_back(i);
+			if (tracker_.active())
+			{
+				tracker_.Moved(ids[i]);
+			}
+		}
+	}
+	others_valid_ = false;
+	view_.reset();
+	ForBothTrees(batch_.size(), pool, [&] (SegmentTree<AoiId>& tree, int axis)
+	{
+		const float* values = axis == 0 ? xs : ys;
+		for (uint32_t i : batch_)
+		{
+			tree.Insert(ids[i], values[i]);
+		}
+	});
+}
+
+void Scene::RemoveMany (const AoiId* ids, size_t n, std::vector<uint8_t>& done, WorkerPool* pool)
+{
+	done.assign(n, 0);
+	if (grid_)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			done[i] = Remove(ids[i]);
+		}
+		return;
+	}
+
+	batch_.clear();
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (positions_.Remove(ids[i]))
+		{
+			done[i] = 1;
+			batch_.push_back(i);
+			if (tracker_.active())
+			{
+				tracker_.Removed(ids[i]);
+			}
+		}
+	}
+	others_valid_ = false;
+	view_.reset();
+	ForBothTrees(batch_.size(), pool, [&] (SegmentTree<AoiId>& tree, int)
+	{
+		for (uint32_t i : batch_)
+		{
+			tree.Remove(ids[i]);
+		}
+	});
+}
+
+void Scene::UpdateMany (const AoiId* ids, const float* xs, const float* ys, size_t n,
+                        std::vector<uint8_t>& done, WorkerPool* pool)
+{
+	done.assign(n, 0);
+	if (grid_)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			done[i] = Update(ids[i], xs[i], ys[i]);
+		}
+		return;
+	}
+
+	// A player moved twice in the batch is moved twice in each
+	// tree too, in the same order, so it ends at the last position.
+	batch_.clear();
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (positions_.Set(ids[i], xs[i], ys[i]))
+		{
+			done[i] = 1;
+			batch_.push_back(i);
+			if (tracker_.active())
+			{
+				tracker_.Moved(ids[i]);
+			}
+		}
+	}
+	others_valid_ = false;
+	view_.reset();
+	ForBothTrees(batch_.size(), pool, [&] (SegmentTree<AoiId>& tree, int axis)
+	{
+		const float* values = axis == 0 ? xs : ys;
+		for (uint32_t i : batch_)
+		{
+			tree.Update(ids[i], values[i]);
+		}
+	});
+}
+
+bool Scene::Load (const AoiId* ids, const float* xs, const float* ys, size_t n, WorkerPool* pool)
+{
+	PositionStore new_positions;
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!new_positions.Insert(ids[i], xs[i], ys[i]))
+		{
+			return false;
+		}
+	}
+
+	positions_.Swap(new_positions);
+	tracker_.Reset();
+	others_valid_ = false;
+	view_.reset();
+	if (grid_)
+	{
+		grid_->Clear();
+		for (size_t i = 0; i < n; ++i)
+		{
+			grid_->Insert(ids[i], xs[i], ys[i]);
+		}
+		return true;
+	}
+	ForBothTrees(n, pool, [&] (SegmentTree<AoiId>& tree, int axis)
+	{
+		tree.Load(axis == 0 ? xs : ys, ids, n);
+	});
+	return true;
+}
+
+const std::vector<AoiId>& Scene::Search (float x_start, float x_end, float y_start, float y_end)
+{
+	candidates_.clear();
+	hits_.clear();
+
+	if (grid_)
+	{
+		grid_->Search(x_start, x_end, y_start, y_end, hits_);
+		return hits_;
+	}
+
+	if (x_end < x_start || y_end < y_start)
+	{
+		return hits_;
+	}
+
+	// Walk the tree of the axis with fewer players in the range, the
+	// other axis is filtered by position. Both trees are counted in
+	// O(logn), so crowds along a road or a corridor are not walked.
+	if (x_tree_.Count(x_start, x_end) <= y_tree_.Count(y_start, y_end))
+	{
+		// Search at x tree.
+		x_tree_.Search(x_start, x_end, candidates_);
+	}
+	else
+	{
+		// Search at y tree.
+		y_tree_.Search(y_start, y_end, candidates_);
+	}
+
+	FilterBox box = BoxOf(x_start, x_end, y_start, y_end);
+	hits_.resize(candidates_.size() + kFilterPadding);
+	size_t n = FilterIds(candidates_.data(), candidates_.size(), positions_.xs(), positions_.ys(), box, hits_.data());
+	hits_.resize(n);
+
+	return hits_;
+}
+
+size_t Scene::Count (float x_start, float x_end, float y_start, float y_end, bool exact)
+{
+	if (grid_)
+	{
+		candidates_.clear();
+		grid_->Search(x_start, x_end, y_start, y_end, candidates_);
+		return candidates_.size();
+	}
+
+	if (!(x_end >= x_start) || !(y_end >= y_start))
+	{
+		return 0;
+	}
+
+	FilterBox box = BoxOf(x_start, x_end, y_start, y_end);
+	size_t x_count = x_tree_.Count(box.x_lo, box.x_hi);
+	size_t y_count = y_tree_.Count(box.y_lo, box.y_hi);
+	bool on_x = x_count <= y_count;
+	if (!exact)
+	{
+		double estimate = static_cast<double>(x_count) * y_count / std::max<size_t>(positions_.size(), 1);
+		return std::min(static_cast<size_t>(estimate + 0.5), on_x ? x_count : y_count);
+	}
+
+	// With the others in leaf order the run of the shorter axis is
+	// counted reading linear memory. Else count the ids the tree finds.
+	if (others_valid_)
+	{
+		const FlatLayout<AoiId>& flat = on_x ? x_tree_.Flat() : y_tree_.Flat();
+		size_t first = flat.LowerBound(on_x ? box.x_lo : box.y_lo);
+		size_t last = flat.UpperBound(on_x ? box.x_hi : box.y_hi, first);
+		const float* others = (on_x ? x_others_.data() : y_others_.data()) + first;
+		return CountRun(others, last - first, on_x ? box.y_lo : box.x_lo, on_x ? box.y_hi : box.x_hi);
+	}
+
+	candidates_.clear();
+	if (on_x)
+	{
+		x_tree_.Search(box.x_lo, box.x_hi, candidates_);
+	}
+	else
+	{
+		y_tree_.Search(box.y_lo, box.y_hi, candidates_);
+	}
+	return CountIds(candidates_.data(), candidates_.size(), positions_.xs(), positions_.ys(), box);
+}
+
+const std::vector<AoiId>& Scene::SearchRadius (float x_pos, float y_pos, float radius)
+{
+	nearest_.clear();
+	if (!(radius >= 0) || positions_.size() == 0)
+	{
+		hits_.clear();
+		return hits_;
+	}
+
+	SearchAround(x_pos, y_pos, radius);
+	KeepInCircle(x_pos, y_pos, radius);
+	return TakeNearest(nearest_.size());
+}
+
+const std::vector<AoiId>& Scene::Nearest (float x_pos, float y_pos, size_t k, float max_radius)
+{
+	nearest_.clear();
+	if (k == 0 || !(max_radius >= 0) || !isfinite(x_pos) || !isfinite(y_pos) || positions_.size() == 0)
+	{
+		hits_.clear();
+		return hits_;
+	}
+
+	// No player is farther than the corners of the range of all
+	// players, so an infinite radius is made finite. Slightly widened,
+	// so rounding can not leave out the farthest player.
+	if (!grid_ || isinf(max_radius))
+	{
+		float x_start, x_end, y_start, y_end;
+		if (!Range(&x_start, &x_end, &y_start, &y_end))
+		{
+			// A single player.
+			positions_.ForEach([&] (size_t, float x, float y)
+			{
+				x_start = x_end = x;
+				y_start = y_end = y;
+			});
+		}
+		float dx = std::max(fabsf(x_pos - x_start), fabsf(x_pos - x_end));
+		float dy = std::max(fabsf(y_pos - y_start), fabsf(y_pos - y_end));
+		max_radius = std::min(max_radius, sqrtf(dx * dx + dy * dy) * (1 + 1e-5f));
+	}
+
+	// Start from the radius that holds about k players by the density
+	// around the position, taken from the trees in O(logn).
+	float radius = max_radius;
+	if (!grid_)
+	{
+		size_t around = Count(x_pos - radius, x_pos + radius, y_pos - radius, y_pos + radius, false);
+		if (around > k)
+		{
+			// A circle holds pi/4 of the square.
+			radius *= std::min(1.0f, sqrtf(static_cast<float>(k) / around * 4 / 3.1415927f) * 1.25f);
+		}
+	}
+
+	for (;;)
+	{
+		nearest_.clear();
+		SearchAround(x_pos, y_pos, radius);
+		KeepInCircle(x_pos, y_pos, radius);
+		if (nearest_.size() >= k || radius >= max_radius)
+		{
+			break;
+		}
+		radius = std::min(radius * 2, max_radius);
+	}
+
+	return TakeNearest(std::min(k, nearest_.size()));
+}
+
+void Scene::SearchMany (const float* rects, size_t n, std::vector<uint32_t>& offsets, std::vector<AoiId>& ids)
+{
+	offsets.assign(n + 1, 0);
+	ids.clear();
+
+	if (grid_)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			const float* r = rects + 4 * i;
+			grid_->Search(r[0], r[1], r[2], r[3], ids);
+			offsets[i + 1] = ids.size();
+		}
+		return;
+	}
+
+	const FlatLayout<AoiId>& x_flat = x_tree_.Flat();
+	const FlatLayout<AoiId>& y_flat = y_tree_.Flat();
+	if (!others_valid_)
+	{
+		BuildOthers();
+	}
+
+	// Sort the ranges by start on both axes. Empty ranges are left out.
+	many_x_starts_.clear();
+	many_y_starts_.clear();
+	many_x_order_.clear();
+	for (size_t i = 0; i < n; ++i)
+	{
+		const float* r = rects + 4 * i;
+		if (!(r[1] >= r[0]) || !(r[3] >= r[2]))
+		{
+			continue;
+		}
+		FilterBox box = BoxOf(r[0], r[1], r[2], r[3]);
+		many_x_starts_.push_back(box.x_lo);
+		many_y_starts_.push_back(box.y_lo);
+		many_x_order_.push_back(i);
+	}
+	many_y_order_ = many_x_order_;
+	RadixSort(many_x_starts_, many_x_order_);
+	RadixSort(many_y_starts_, many_y_order_);
+
+	// Sweep each axis to find the run of leaves of every range. Every
+	// range starts looking from the first leaf of the one before, so
+	// this also counts the players on both axes for free.
+	many_runs_.resize(n);
+	SweepRuns(x_flat, many_x_starts_, many_x_order_, rects, 0);
+	SweepRuns(y_flat, many_y_starts_, many_y_order_, rects, 1);
+
+	// Filter the shorter run of every range on the other axis, in the
+	// order of the sweep so the runs read are still in cache. Found
+	// players are kept in hits_ in this order for now.
+	many_spans_.assign(n, std::make_pair(0, 0));
+	hits_.clear();
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		const FlatLayout<AoiId>& flat = axis ? y_flat : x_flat;
+		const float* others = axis ? y_others_.data() : x_others_.data();
+		for (uint32_t q : axis ? many_y_order_ : many_x_order_)
+		{
+			const Run& x_run = many_runs_[q][0];
+			const Run& y_run = many_runs_[q][1];
+			bool on_y = x_run.second - x_run.first > y_run.second - y_run.first;
+			if (on_y != (axis == 1))
+			{
+				continue;
+			}
+
+			const float* r = rects + 4 * q;
+			FilterBox box = BoxOf(r[0], r[1], r[2], r[3]);
+			float lo = axis ? box.x_lo : box.y_lo;
+			float hi = axis ? box.x_hi : box.y_hi;
+			const Run& run = many_runs_[q][axis];
+
+			size_t used = hits_.size();
+			hits_.resize(used + (run.second - run.first) + kFilterPadding);
+			size_t found = FilterRun(flat.ids() + run.first, others + run.first, run.second - run.first,
+			                         lo, hi, hits_.data() + used);
+			hits_.resize(used + found);
+			many_spans_[q] = std::make_pair(used, used + found);
+		}
+	}
+
+	// Put the players found back in the order of the ranges.
+	for (size_t i = 0; i < n; ++i)
+	{
+		offsets[i + 1] = offsets[i] + (many_spans_[i].second - many_spans_[i].first);
+	}
+	ids.resize(offsets[n]);
+	for (size_t i = 0; i < n; ++i)
+	{
+		std::copy(hits_.begin() + many_spans_[i].first, hits_.begin() + many_spans_[i].second, ids.begin() + offsets[i]);
+	}
+}
+
+uint64_t Scene::Publish ( )
+{
+	view_ = MakeView(++version_);
+	std::atomic_store(&published_, view_);
+	return version_;
+}
+
+bool Scene::Range (float* x_start, float* x_end, float* y_start, float* y_end)
+{
+	if (!grid_)
+	{
+		return x_tree_.Range(x_start, x_end) && y_tree_.Range(y_start, y_end);
+	}
+
+	if (positions_.size() < 2)
+	{
+		return false;
+	}
+
+	// The grid does not keep bounds, go through all players.
+	*x_start = *y_start = INFINITY;
+	*x_end = *y_end = -INFINITY;
+	positions_.ForEach([&] (size_t, float x_pos, float y_pos)
+	{
+		*x_start = std::min(*x_start, x_pos);
+		*x_end = std::max(*x_end, x_pos);
+		*y_start = std::min(*y_start, y_pos);
+		*y_end = std::max(*y_end, y_pos);
+	});
+	return true;
+}
+
+void Scene::Close ( )
+{
+	x_tree_.Release();
+	y_tree_.Release();
+	tracker_.Clear();
+	if (grid_)
+	{
+		grid_->Clear();
+	}
+	positions_.Release();
+	std::vector<AoiId>().swap(candidates_);
+	std::vector<AoiId>().swap(hits_);
+	std::vector<std::pair<float, AoiId>>().swap(nearest_);
+	std::vector<float>().swap(x_others_);
+	std::vector<float>().swap(y_others_);
+	others_valid_ = false;
+	view_.reset();
+	std::atomic_store(&published_, std::shared_ptr<const SceneView<AoiId>>());
+	std::vector<float>().swap(many_x_starts_);
+	std::vector<float>().swap(many_y_starts_);
+	std::vector<uint32_t>().swap(many_x_order_);
+	std::vector<uint32_t>().swap(many_y_order_);
+	std::vector<std::array<Run, 2>>().swap(many_runs_);
+	std::vector<std::pair<uint32_t, uint32_t>>().swap(many_spans_);
+}
+
+// endregion public method
+
+// region private method
+
+std::shared_ptr<const SceneView<AoiId>> Scene::MakeView (uint64_t version)
+{
+	FlatLayout<AoiId> x_flat, y_flat;
+	if (grid_)
+	{
+		// The grid keeps no order, sort the players.
+		SortedFlat(positions_, false, x_flat);
+		SortedFlat(positions_, true, y_flat);
+	}
+	else
+	{
+		x_flat = x_tree_.Flat();
+		y_flat = y_tree_.Flat();
+	}
+	return std::make_shared<SceneView<AoiId>>(version, std::move(x_flat), std::move(y_flat),
+	        positions_.xs(), positions_.ys());
+}
+
+template <typename F>
+void Scene::ForBothTrees (size_t n, WorkerPool* pool, F f)
+{
+	if (pool == nullptr || pool->threads() == 0 || n < kParallelBatch)
+	{
+		f(x_tree_, 0);
+		f(y_tree_, 1);
+		return;
+	}
+	pool->ParallelFor(2, [&] (size_t axis)
+	{
+		f(axis == 0 ? x_tree_ : y_tree_, static_cast<int>(axis));
+	});
+}
+
+FilterBox Scene::BoxOf (float x_start, float x_end, float y_start, float y_end)
+{
+	// The same bounds as InRange, with the exclusive ones made closed.
+	if (x_end - x_start < y_end - y_start)
+	{
+		return FilterBox{x_start, x_end, nextafterf(y_start, INFINITY), nextafterf(y_end, -INFINITY)};
+	}
+	return FilterBox{nextafterf(x_start, INFINITY), nextafterf(x_end, -INFINITY), y_start, y_end};
+}
+
+void Scene::SearchAround (float x_pos, float y_pos, float radius)
+{
+	// Widened by an ulp, so rounding of the bounds can not leave out
+	// a player right on the circle.
+	float x_start = nextafterf(x_pos - radius, -INFINITY), x_end = nextafterf(x_pos + radius, INFINITY);
+	float y_start = nextafterf(y_pos - radius, -INFINITY), y_end = nextafterf(y_pos + radius, INFINITY);
+
+	candidates_.clear();
+	if (grid_)
+	{
+		grid_->Search(x_start, x_end, y_start, y_end, candidates_);
+	}
+	else if (x_tree_.Count(x_start, x_end) <= y_tree_.Count(y_start, y_end))
+	{
+		x_tree_.Search(x_start, x_end, candidates_);
+	}
+	else
+	{
+		y_tree_.Search(y_start, y_end, candidates_);
+	}
+}
+
+void Scene::KeepInCircle (float x_pos, float y_pos, float radius)
+{
+	const float* xs = positions_.xs();
+	const float* ys = positions_.ys();
+	float max_distance = radius * radius;
+	for (AoiId id : candidates_)
+	{
+		float dx = xs[id] - x_pos;
+		float dy = ys[id] - y_pos;
+		float distance = dx * dx + dy * dy;
+		if (distance <= max_distance)
+		{
+			nearest_.push_back(std::make_pair(distance, id));
+		}
+	}
+}
+
+const std::vector<AoiId>& Scene::TakeNearest (size_t n)
+{
+	// Ties are broken by id, so the order does not depend on the trees.
+	std::partial_sort(nearest_.begin(), nearest_.begin() + n, nearest_.end());
+	hits_.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		hits_[i] = nearest_[i].second;
+	}
+	return hits_;
+}
+
+void Scene::SweepRuns (const FlatLayout<AoiId>& flat, const std::vector<float>& starts,
+                       const std::vector<uint32_t>& order, const float* rects, int axis)
+{
+	size_t first = 0;
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		uint32_t q = order[i];
+		const float* r = rects + 4 * q;
+		FilterBox box = BoxOf(r[0], r[1], r[2], r[3]);
+
+		first = flat.LowerBound(starts[i], first);
+		size_t last = flat.UpperBound(axis ? box.y_hi : box.x_hi, first);
+		many_runs_[q][axis] = Run(first, last);
+	}
+}
+
+void Scene::BuildOthers ( )
+{
+	const FlatLayout<AoiId>& x_flat = x_tree_.Flat();
+	const FlatLayout<AoiId>& y_flat = y_tree_.Flat();
+
+	x_others_.resize(x_flat.size());
+	for (size_t i = 0; i < x_flat.size(); ++i)
+	{
+		x_others_[i] = positions_.ys()[x_flat.ids()[i]];
+	}
+
+	y_others_.resize(y_flat.size());
+	for (size_t i = 0; i < y_flat.size(); ++i)
+	{
+		y_others_[i] = positions_.xs()[y_flat.ids()[i]];
+	}
+
+	others_valid_ = true;
+}
+
+// endregion private method
@@ -0,0 +1,378 @@
+//////////////////////////////////////////////////
+// @fileoverview Defination of an aoi scene.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "segment_tree.h"
+#include "grid_index.h"
+#include "interest_tracker.h"
+#include "position_store.h"
+#include "filter_kernel.h"
+#include "snapshot.h"
+#include "scene_view.h"
+#include "worker_pool.h"
+
+// Width of player ids, 16 or 32 bits. Set by binding.gyp.
+#ifndef AOI_ID_BITS
+#define AOI_ID_BITS 32
+#endif
+
+namespace ysd_bes_aoi
+{
+
+#if AOI_ID_BITS == 16
+	typedef uint16_t AoiId;
+#else
+	typedef uint32_t AoiId;
+#endif
+
+	///////////////////////////////////////////////////
+	// A 2d game scene. It owns a segment tree for each
+	// axis, or a grid, and the positions of its players,
+	// so the cost of a query only depends on the
+	// population of this scene.
+	///////////////////////////////////////////////////
+	class Scene final
+	{
+	public:
+
+		// A scene indexed by a segment tree for each axis.
+		Scene ( ) = default;
+
+		// A scene indexed by a grid.
+		// @param[in]	cell_size 	Width and height of a grid cell.
+		explicit Scene (float cell_size) :
+			grid_ (new GridIndex<AoiId>(cell_size))
+		{
+
+		}
+
+		Scene (const Scene&) = delete;
+		Scene& operator= (const Scene&) = delete;
+
+		// Add a player to the scene.
+		// @return 	False if the id is already in the scene, or not
+		//			less than PositionStore::kMaxIds.
+		bool Insert (AoiId id, float x_pos, float y_pos);
+
+		// Remove a player from the scene.
+		// @return 	False if the id is not in the scene.
+		bool Remove (AoiId id);
+
+		// Move a player.
+		// @return 	False if the id is not in the scene.
+		bool Update (AoiId id, float x_pos, float y_pos);
+
+		// Batches of at least this many players change the x and y
+		// trees at once, on two threads. A guess to skip the wake up
+		// for small batches, not measured on more than one core.
+		static const size_t kParallelBatch = 512;
+
+		// Add, remove or move many players. The positions are changed
+		// first, in order, then the x tree and the y tree, which share
+		// nothing, take the batch at the same time: one on the calling
+		// thread and one on the pool. The result is the same as making
+		// the calls one by one.
+		// @param[in]	pool 	Threads to change a tree on, or null to
+		//						change both on the calling thread.
+		// @param[out]	done 	For every player, 1 if the call for it
+		//						is successful.
+		void InsertMany (const AoiId* ids, const float* xs, const float* ys, size_t n,
+		                 std::vector<uint8_t>& done, WorkerPool* pool = nullptr);
+		void RemoveMany (const AoiId* ids, size_t n, std::vector<uint8_t>& done, WorkerPool* pool = nullptr);
+		void UpdateMany (const AoiId* ids, const float* xs, const float* ys, size_t n,
+		                 std::vector<uint8_t>& done, WorkerPool* pool = nullptr);
+
+		// Replace all players at once. The trees are built at the
+		// same time if a pool is given, as the batches above.
+		// @param[in]	ids 	Player ids.
+		// @param[in]	xs 		X coordinates, in the same order of ids.
+		// @param[in]	ys 		Y coordinates, in the same order of ids.
+		// @param[in]	n 		Number of players.
+		// @return 	False if there are duplicate or too big ids, the
+		//			scene is not changed then.
+		bool Load (const AoiId* ids, const float* xs, const float* ys, size_t n, WorkerPool* pool = nullptr);
+
+		// Search players in a given square range.
+		// @return 	Ids of the players found, valid until the next search.
+		const std::vector<AoiId>& Search (float x_start, float x_end, float y_start, float y_end);
+
+		// Count players in a given square range, with the same
+		// bounds as Search, without making a list of them.
+		// @param[in]	exact 	If false, estimate from the players in
+		//						the range on each axis, in O(logn), as if
+		//						x and y were independent. The estimate is
+		//						never over the count on either axis. A grid
+		//						scene always counts.
+		// @return 	Number of players in the range.
+		size_t Count (float x_start, float x_end, float y_start, float y_end, bool exact = true);
+
+		// Search players in a circle.
+		// @param[in]	x_pos, y_pos 	Center of the circle.
+		// @param[in]	radius 			Players as far as radius are found.
+		// @return 	Ids of the players found, nearest first, valid until
+		//			the next search.
+		const std::vector<AoiId>& SearchRadius (float x_pos, float y_pos, float radius);
+
+		// Search the k players nearest to a position. The square around
+		// it grows until k players are found in the circle it contains,
+		// then no player out of the square can be nearer.
+		// @param[in]	x_pos, y_pos 	The position.
+		// @param[in]	k 				Most players to find.
+		// @param[in]	max_radius 		Players farther than this are not found.
+		// @return 	Ids of the players found, nearest first, valid until
+		//			the next search.
+		const std::vector<AoiId>& Nearest (float x_pos, float y_pos, size_t k, float max_radius);
+
+		// Search players in many square ranges at once. The ranges are
+		// sorted along each axis, so consecutive ones share the leaves
+		// they read, and the other axis is read from a copy in the order
+		// of the leaves instead of by id.
+		// @param[in]	rects 	(x_start, x_end, y_start, y_end) of every range.
+		// @param[in]	n 		Number of ranges.
+		// @param[out]	offsets	n + 1 offsets into ids: the players found in
+		//						range i are ids[offsets[i]] to ids[offsets[i + 1] - 1].
+		// @param[out]	ids 	Ids of the players found, in the order of the ranges.
+		void SearchMany (const float* rects, size_t n, std::vector<uint32_t>& offsets, std::vector<AoiId>& ids);
+
+		// Write all players and the leaves of both trees to a file, see
+		// snapshot.h. It is written next to the path and renamed over
+		// it, so a crash never leaves half a snapshot. Watch ranges
+		// are not saved.
+		// @return 	False if the file can not be written.
+		bool Save (const char* path);
+
+		// Replace all players with the ones of a snapshot. The file is
+		// mapped and checked, then the trees are built from the sorted
+		// leaves in it in one linear pass, with no sort or rotation.
+		// @return 	False if the file can not be read or is not a valid
+		//			snapshot of the same id width, the scene is not
+		//			changed then.
+		bool Restore (const char* path);
+
+		// Number of players.
+		size_t size ( ) const
+		{
+			return positions_.size();
+		}
+
+		// Get the position of a player.
+		// @return 	False if the id is not in the scene.
+		bool Position (AoiId id, float* x_pos, float* y_pos) const
+		{
+			return positions_.Get(id, x_pos, y_pos);
+		}
+
+		// If a position is in a search range. Search tests the axis
+		// with the shorter range with inclusive bounds, the other
+		// one with exclusive bounds. Search itself filters with
+		// FilterIds, which must agree with this.
+		static bool InRange (float x_start, float x_end, float y_start, float y_end, float x_pos, float y_pos)
+		{
+			if (x_end - x_start < y_end - y_start)
+				return x_pos >= x_start && x_pos <= x_end && y_pos > y_start && y_pos < y_end;
+			return x_pos > x_start && x_pos < x_end && y_pos >= y_start && y_pos <= y_end;
+		}
+
+		// Set the watch range of a subscriber. Events finds out
+		// which players enter or leave the range.
+		void Watch (AoiId subscriber, float x_start, float x_end, float y_start, float y_end)
+		{
+			tracker_.Watch(subscriber, x_start, x_end, y_start, y_end);
+		}
+
+		// Remove a subscriber.
+		// @return 	False if it is not a subscriber.
+		bool Unwatch (AoiId subscriber)
+		{
+			return tracker_.Unwatch(subscriber);
+		}
+
+		// Get the players which enter or leave the range of every
+		// subscriber since the last call. Only moved players and
+		// changed ranges are looked at.
+		// @param[out]	enter 	(subscriber, player) pairs, flattened.
+		// @param[out]	leave 	(subscriber, player) pairs, flattened.
+		void Events (std::vector<AoiId>& enter, std::vector<AoiId>& leave)
+		{
+			tracker_.Collect(*this, enter, leave);
+		}
+
+		// Get the square range of all players.
+		// @return 	False if there are less than two players.
+		bool Range (float* x_start, float* x_end, float* y_start, float* y_end);
+
+		// Rebuild the flat search layout of both trees.
+		void Flatten ( )
+		{
+			if (grid_)
+			{
+				return;
+			}
+			others_valid_ = false;
+			x_tree_.Flatten();
+			y_tree_.Flatten();
+		}
+
+		// Get the counters of both segment trees. They are
+		// all zero for a grid scene.
+		void Stats (TreeStats* x_stats, TreeStats* y_stats) const
+		{
+			*x_stats = x_tree_.stats();
+			*y_stats = y_tree_.stats();
+		}
+
+		// Print the segment trees by layer.
+		// @param[in]	x 	If print x coordinate.
+		// @param[in]	y 	If print y coordinate.
+		void Print (bool x, bool y)
+		{
+			if (x)
+				x_tree_.Print();
+			if (y)
+				y_tree_.Print();
+		}
+
+		// Remove all players and give the memory back.
+		void Close ( );
+
+		// The box FilterIds keeps the same players as InRange with.
+		static FilterBox BoxOf (float x_start, float x_end, float y_start, float y_end);
+
+		// Publish a view of the players as they are now, e.g. at the
+		// end of a tick. Views are never changed, so threads can search
+		// the last published one while this scene goes on changing.
+		// Old views are freed when the last thread holding one drops it.
+		// @return 	Version of the view, counting up from 1.
+		uint64_t Publish ( );
+
+		// Get a view of the players as they are now, e.g. for a search
+		// on another thread. Making one copies the leaves of the scene,
+		// so it is kept and given again until the players change. It
+		// is the published view if nothing changed since Publish, else
+		// its version is 0.
+		std::shared_ptr<const SceneView<AoiId>> View ( )
+		{
+			if (!view_)
+			{
+				view_ = MakeView(0);
+			}
+			return view_;
+		}
+
+		// Get the last published view. Safe to call from any thread,
+		// and it does not block the writer while the scene changes.
+		// It is not lock-free: atomic_load on a shared_ptr takes one of
+		// a few mutexes inside the library, held only to copy the
+		// pointer, so it can wait at most for another such copy.
+		// @return 	Null if nothing is published.
+		std::shared_ptr<const SceneView<AoiId>> Published ( ) const
+		{
+			return std::atomic_load(&published_);
+		}
+
+	private:
+
+		// Copy the flat layouts of the players into a new view.
+		std::shared_ptr<const SceneView<AoiId>> MakeView (uint64_t version);
+
+		// Get the players in the square around a circle, as candidates_.
+		void SearchAround (float x_pos, float y_pos, float radius);
+
+		// Keep the candidates in a circle, as (squared distance, id)
+		// pairs in nearest_.
+		void KeepInCircle (float x_pos, float y_pos, float radius);
+
+		// Put the first n of nearest_ in order of distance into hits_.
+		const std::vector<AoiId>& TakeNearest (size_t n);
+
+		// Call f(tree, axis) for the x tree with axis 0 and the y
+		// tree with axis 1, at the same time if the pool has a
+		// thread and the batch of n players is big enough.
+		template <typename F>
+		void ForBothTrees (size_t n, WorkerPool* pool, F f);
+
+		// Restore from the bytes of a snapshot file.
+		bool RestoreFrom (const char* data, size_t size);
+
+		// Leaves [first, second) of a flat layout.
+		typedef std::pair<uint32_t, uint32_t> Run;
+
+		// Find the run of leaves of every range on an axis.
+		// @param[in]	starts 	Start of the ranges on the axis, sorted.
+		// @param[in]	order 	Index of the range of every start.
+		// @param[in]	axis 	0 for x, 1 for y.
+		void SweepRuns (const FlatLayout<AoiId>& flat, const std::vector<float>& starts,
+		                const std::vector<uint32_t>& order, const float* rects, int axis);
+
+		// Copy the other coordinate of the leaves of both flat
+		// layouts, in the order of the leaves.
+		void BuildOthers ( );
+
+		// A segment tree that maintain the x coordinate of all players.
+		SegmentTree<AoiId> x_tree_;
+
+		// A segment tree that maintain the y coordinate of all players.
+		SegmentTree<AoiId> y_tree_;
+
+		// The grid used instead of the trees, if any.
+		std::unique_ptr<GridIndex<AoiId>> grid_;
+
+		// Subscribers of enter/leave events.
+		InterestTracker<AoiId> tracker_;
+
+		// Store all positions with key of ID.
+		PositionStore positions_;
+
+		// Ids found on the searched tree, reused by every search.
+		std::vector<AoiId> candidates_;
+
+		// Ids of the last search result, reused by every search.
+		std::vector<AoiId> hits_;
+
+		// Y coordinates in the order of the x tree's leaves, and
+		// x coordinates in the order of the y tree's leaves.
+		std::vector<float> x_others_;
+		std::vector<float> y_others_;
+
+		// Players found by SearchRadius and Nearest with their
+		// squared distance, reused by every search.
+		std::vector<std::pair<float, AoiId>> nearest_;
+
+		// The last published view, read by other threads.
+		std::shared_ptr<const SceneView<AoiId>> published_;
+
+		// The view of the players as they are now, made by View or
+		// Publish, and dropped when they change.
+		std::shared_ptr<const SceneView<AoiId>> view_;
+
+		// Version of the last published view.
+		uint64_t version_ = 0;
+
+		// Indexes of the players of a batch whose position is changed,
+		// which the trees take after it.
+		std::vector<uint32_t> batch_;
+
+		// If the others match the trees.
+		bool others_valid_ = false;
+
+		// Scratch buffers of SearchMany: starts of the ranges sorted on
+		// each axis and the ranges in that order, the runs of leaves of
+		// every range on both axes, and where the players found in every
+		// range start and end in hits_.
+		std::vector<float> many_x_starts_;
+		std::vector<float> many_y_starts_;
+		std::vector<uint32_t> many_x_order_;
+		std::vector<uint32_t> many_y_order_;
+		std::vector<std::array<Run, 2>> many_runs_;
+		std::vector<std::pair<uint32_t, uint32_t>> many_spans_;
+	};
+}
+
+#endif
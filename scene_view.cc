@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////
+// @fileoverview Immutable view of a scene, read by
+//				 many threads at once.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <algorithm>
+#include "scene_view.h"
+
+using namespace ysd_bes_aoi;
+
+// region public method
+
+template <typename Id>
+SceneView<Id>::SceneView (uint64_t version, FlatLayout<Id>&& x_flat, FlatLayout<Id>&& y_flat, const float* xs, const float* ys) :
+	version_ (version), x_flat_ (std::move(x_flat)), y_flat_ (std::move(y_flat))
+{
+	x_others_.resize(x_flat_.size());
+	for (size_t i = 0; i < x_flat_.size(); ++i)
+	{
+		x_others_[i] = ys[x_flat_.ids()[i]];
+	}
+
+	y_others_.resize(y_flat_.size());
+	for (size_t i = 0; i < y_flat_.size(); ++i)
+	{
+		y_others_[i] = xs[y_flat_.ids()[i]];
+	}
+}
+
+template <typename Id>
+void SceneView<Id>::Search (const FilterBox& box, std::vector<Id>& result) const
+{
+	result.clear();
+
+	size_t x_first = x_flat_.LowerBound(box.x_lo);
+	size_t x_last = std::max(x_first, x_flat_.UpperBound(box.x_hi));
+	size_t y_first = y_flat_.LowerBound(box.y_lo);
+	size_t y_last = std::max(y_first, y_flat_.UpperBound(box.y_hi));
+
+	// Filter the shorter run by the other coordinate, linear reads only.
+	bool on_x = x_last - x_first <= y_last - y_first;
+	const FlatLayout<Id>& flat = on_x ? x_flat_ : y_flat_;
+	size_t first = on_x ? x_first : y_first;
+	size_t n = on_x ? x_last - x_first : y_last - y_first;
+	const float* others = (on_x ? x_others_.data() : y_others_.data()) + first;
+
+	result.resize(n + kFilterPadding);
+	size_t found = on_x ? FilterRun(flat.ids() + first, others, n, box.y_lo, box.y_hi, result.data())
+	               : FilterRun(flat.ids() + first, others, n, box.x_lo, box.x_hi, result.data());
+	result.resize(found);
+}
+
+// endregion public method
+
+template class ysd_bes_aoi::SceneView<uint16_t>;
+template class ysd_bes_aoi::SceneView<uint32_t>;
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////
+// @fileoverview Immutable view of a scene, read by
+//				 many threads at once.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _SCENE_VIEW_H_
+#define _SCENE_VIEW_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "flat_layout.h"
+#include "filter_kernel.h"
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// The players of a scene at one point in time, e.g.
+	// the end of a tick: the flat layout of both axes and
+	// the other coordinate of their leaves in the same
+	// order. It is never changed after it is made, so any
+	// number of threads can search it without locking the
+	// scene while the scene itself goes on changing.
+	///////////////////////////////////////////////////
+	template <typename Id>
+	class SceneView final
+	{
+	public:
+
+		// Take the flat layouts of both axes.
+		// @param[in]	version 	Number of the view, counting up.
+		// @param[in]	xs, ys 		Coordinates of the players, indexed by id.
+		SceneView (uint64_t version, FlatLayout<Id>&& x_flat, FlatLayout<Id>&& y_flat, const float* xs, const float* ys);
+
+		SceneView (const SceneView&) = delete;
+		SceneView& operator= (const SceneView&) = delete;
+
+		// Search players in a box, on the axis with fewer players
+		// in it. Safe to call from any thread.
+		// @param[in]	box 		The box, see Scene::BoxOf.
+		// @param[out]	result 		Ids of the players found, replaced.
+		void Search (const FilterBox& box, std::vector<Id>& result) const;
+
+		uint64_t version ( ) const
+		{
+			return version_;
+		}
+
+		// Number of players.
+		size_t size ( ) const
+		{
+			return x_flat_.size();
+		}
+
+	private:
+
+		const uint64_t version_;
+
+		FlatLayout<Id> x_flat_;
+		FlatLayout<Id> y_flat_;
+
+		// Y coordinates in the order of x_flat_, and x coordinates
+		// in the order of y_flat_.
+		std::vector<float> x_others_;
+		std::vector<float> y_others_;
+	};
+}
+
+#endif
@@ -8,596 +8,551 @@
 using namespace ysd_bes_aoi;
 
 // region public method
-// endregion public method
-
-// region static method
 
 // Create non-leaf node recursively with value array and id array.
-TreeNode* SegmentTree::CreateSegmentTree (float* values, uint16_t* ids, int i, int j)
+template <typename Id>
+NodeIndex SegmentTree<Id>::CreateSegmentTree (float* values, Id* ids, int i, int j)
 {
 	assert(j > i);
-	TreeNode* root = new TreeNode();
+	NodeIndex root = pool_.Alloc();
 	if (j - i == 1)
 	{
-		root->pos_start = values[i];
-		root->id = ids[i];
-		root->height = 0;
+		TreeNode<Id>& p = Node(root);
+		p.pos_start = values[i];
+		p.id = ids[i];
+		p.height = 0;
+		SetLeaf(ids[i], root);
 	}
 	else
 	{
 		int mid = ((j - i) >> 1) + i;
-		root->pos_start = values[i];
-		root->pos_end = values[j - 1];
-		// Non-leaf node's id = 10000.
-		root->id = kNonID;
-		if (mid > i)
-			root->left = CreateSegmentTree(values, ids, i, mid);
-		if (j > mid)
-			root->right = CreateSegmentTree(values, ids, mid, j);
-		root->height = 1 + std::max(root->left->height, root->right->height);
+		NodeIndex left = CreateSegmentTree(values, ids, i, mid);
+		NodeIndex right = CreateSegmentTree(values, ids, mid, j);
+		TreeNode<Id>& p = Node(root);
+		p.leaf = false;
+		p.left = left;
+		p.right = right;
+		ResetRange(root);
 	}
 	return root;
 }
 
-// endregion static method
+template <typename Id>
+void SegmentTree<Id>::Load (const float* values, const Id* ids, size_t n)
+{
+	flat_values_.assign(values, values + n);
+	flat_ids_.assign(ids, ids + n);
+	RadixSort(flat_values_, flat_ids_);
+	BuildSorted();
+}
+
+template <typename Id>
+void SegmentTree<Id>::LoadSorted (const float* values, const Id* ids, size_t n)
+{
+	flat_values_.assign(values, values + n);
+	flat_ids_.assign(ids, ids + n);
+	BuildSorted();
+}
+
+// Collect the leaves in order and hand them to the flat layout.
+template <typename Id>
+void SegmentTree<Id>::Flatten ( )
+{
+	flat_values_.clear();
+	flat_ids_.clear();
+	flat_stack_.clear();
+
+	NodeIndex i = root_;
+	while (i != kNoNode || !flat_stack_.empty())
+	{
+		if (i == kNoNode)
+		{
+			i = flat_stack_.back();
+			flat_stack_.pop_back();
+		}
+
+		// Go down the left side and keep the right children for later.
+		const TreeNode<Id>* p = &Node(i);
+		while (!p->leaf)
+		{
+			flat_stack_.push_back(p->right);
+			p = &Node(p->left);
+		}
+
+		flat_values_.push_back(p->pos_start);
+		flat_ids_.push_back(p->id);
+		i = kNoNode;
+	}
+
+	flat_.Build(flat_values_, flat_ids_);
+	flat_valid_ = true;
+}
+
+template <typename Id>
+bool SegmentTree<Id>::Remove (Id id)
+{
+	NodeIndex leaf = LeafOf(id);
+	if (leaf == kNoNode)
+	{
+		return false;
+	}
+	Invalidate();
+	leaves_[id] = kNoNode;
+
+	if (leaf == root_)
+	{
+		// The last node.
+		pool_.Free(leaf);
+		root_ = kNoNode;
+		return true;
+	}
+
+	FixUp(Node(UnlinkLeaf(leaf)).parent);
+	return true;
+}
+
+template <typename Id>
+bool SegmentTree<Id>::Update (Id id, float new_val)
+{
+	NodeIndex leaf = LeafOf(id);
+	if (leaf == kNoNode)
+	{
+		return false;
+	}
+	Invalidate();
+
+	// Still between its neighbours, only the ranges above it change.
+	NodeIndex prev = PrevLeaf(leaf);
+	NodeIndex next = NextLeaf(leaf);
+	if ((prev == kNoNode || Node(prev).pos_start <= new_val) && (next == kNoNode || new_val <= Node(next).pos_start))
+	{
+		Node(leaf).pos_start = new_val;
+		FixRanges(leaf);
+		++stats_.update_in_place;
+		return true;
+	}
+
+	if (ShiftTo(leaf, new_val, next != kNoNode && new_val > Node(next).pos_start))
+	{
+		++stats_.update_shifted;
+		return true;
+	}
+
+	// Take the leaf out and insert it again at the new value.
+	FixUp(Node(UnlinkLeaf(leaf)).parent);
+	root_ = InsertNode(root_, id, new_val);
+	Node(root_).parent = kNoNode;
+	++stats_.update_reinserted;
+	return true;
+}
+
+template <typename Id>
+TreeStats SegmentTree<Id>::stats ( ) const
+{
+	TreeStats stats = stats_;
+	stats.leaves = size();
+	stats.height = root_ == kNoNode ? 0 : Node(root_).height;
+	stats.ideal_height = 0;
+	while ((size_t(1) << stats.ideal_height) < stats.leaves)
+	{
+		++stats.ideal_height;
+	}
+	stats.nodes = pool_.live();
+	stats.bytes = pool_.capacity() * sizeof(TreeNode<Id>) + leaves_.capacity() * sizeof(NodeIndex) + flat_.bytes();
+	return stats;
+}
+
+// endregion public method
 
 // region private method
 
+template <typename Id>
+void SegmentTree<Id>::BuildSorted ( )
+{
+	Clear();
+
+	size_t n = flat_values_.size();
+	if (n > 0)
+	{
+		root_ = CreateSegmentTree(flat_values_.data(), flat_ids_.data(), 0, n);
+		Node(root_).parent = kNoNode;
+	}
+
+	// The sorted leaves are exactly what the flat layout needs.
+	flat_.Build(flat_values_, flat_ids_);
+	flat_valid_ = true;
+}
+
+// Rotate the node if the heights of its children differ by more than one.
+template <typename Id>
+NodeIndex SegmentTree<Id>::Balance (NodeIndex root)
+{
+	const TreeNode<Id>& p = Node(root);
+	const TreeNode<Id>& left = Node(p.left);
+	const TreeNode<Id>& right = Node(p.right);
+	int diff = left.height - right.height;
+	if (diff > 1)
+	{
+		// Left child is higher.
+		if (Node(left.left).height >= Node(left.right).height)
+		{
+			AOI_STAT(++stats_.rotations_r);
+			return RotateTreeR(root);
+		}
+		AOI_STAT(++stats_.rotations_lr);
+		return RotateTreeLR(root);
+	}
+	else if (diff < -1)
+	{
+		// Right child is higher.
+		if (Node(right.right).height >= Node(right.left).height)
+		{
+			AOI_STAT(++stats_.rotations_l);
+			return RotateTreeL(root);
+		}
+		AOI_STAT(++stats_.rotations_rl);
+		return RotateTreeRL(root);
+	}
+
+	ResetRange(root);
+	return root;
+}
+
 // Search the tree recusively to find the position in the range and push the id in result.
-void SegmentTree::SearchRange (const TreeNode* root, const float start, const float end, std::vector<uint16_t>& result)
+template <typename Id>
+void SegmentTree<Id>::SearchRange (NodeIndex root, const float start, const float end, std::vector<Id>& result)
 {
+	AOI_STAT(++stats_.nodes_visited);
+	const TreeNode<Id>& p = Node(root);
 
 	// It is a leaf node.
-	if (root->id != kNonID)
+	if (p.leaf)
 	{
-		if (root->pos_start <= end && root->pos_start >= start)
+		if (p.pos_start <= end && p.pos_start >= start)
 		{
-			result.push_back(root->id);
+			result.push_back(p.id);
 		}
 		return;
 	}
 
-	if (root->pos_start > end || root->pos_end < start)
+	if (p.pos_start > end || p.pos_end < start)
 	{
 		// The two range have no coincident area.
 		return;
 	}
 
-	SearchRange(root->left, start, end, result);
-	SearchRange(root->right, start, end, result);
+	SearchRange(p.left, start, end, result);
+	SearchRange(p.right, start, end, result);
+
+}
+
+template <typename Id>
+size_t SegmentTree<Id>::CountRange (NodeIndex root, const float start, const float end) const
+{
+	const TreeNode<Id>& p = Node(root);
+	if (p.leaf)
+	{
+		return p.pos_start <= end && p.pos_start >= start ? 1 : 0;
+	}
+
+	if (p.pos_start > end || p.pos_end < start)
+	{
+		// The two range have no coincident area.
+		return 0;
+	}
+
+	if (p.pos_start >= start && p.pos_end <= end)
+	{
+		// The whole tree is in the range.
+		return p.count;
+	}
 
+	return CountRange(p.left, start, end) + CountRange(p.right, start, end);
 }
 
-TreeNode* SegmentTree::InsertNode (TreeNode* root, uint16_t id, float value)
+template <typename Id>
+NodeIndex SegmentTree<Id>::InsertNode (NodeIndex root, Id id, float value)
 {
 
 	// null tree.
-	if (root == nullptr)
+	if (root == kNoNode)
 	{
-		root = new TreeNode();
-		root->id = id;
-		root->pos_start = value;
+		root = pool_.Alloc();
+		TreeNode<Id>& p = Node(root);
+		p.id = id;
+		p.pos_start = value;
+		SetLeaf(id, root);
 		return root;
 	}
 
 	// A leaf root.
-	if (root->id != kNonID)
+	if (Node(root).leaf)
 	{
-		// Two new child nodes.
-		TreeNode* left = new TreeNode();
-		left->height = 0;
-
-		TreeNode* right = new TreeNode();
-		right->height = 0;
-		if (root->pos_start < value)
+		// Two new child nodes. Slabs never move, so the
+		// references stay good across the allocations.
+		NodeIndex left = pool_.Alloc();
+		NodeIndex right = pool_.Alloc();
+		TreeNode<Id>& p = Node(root);
+		TreeNode<Id>& l = Node(left);
+		TreeNode<Id>& r = Node(right);
+		l.height = 0;
+		r.height = 0;
+		if (p.pos_start < value)
 		{
 			// The left node is equal to the root.
-			left->id = root->id;
-			left->pos_start = root->pos_start;
+			l.id = p.id;
+			l.pos_start = p.pos_start;
 
 			// The right node is the new inserted node.
-			right->id = id;
-			right->pos_start = value;
+			r.id = id;
+			r.pos_start = value;
 		}
 		else
 		{
 			// The left node is the new inserted node.
-			left->id = id;
-			left->pos_start = value;
+			l.id = id;
+			l.pos_start = value;
 
 			// The right node is equal to the root.
-			right->id = root->id;
-			right->pos_start = root->pos_start;
+			r.id = p.id;
+			r.pos_start = p.pos_start;
 		}
 
 		// Change the root to non-leaf node.
-		root->id = kNonID;
-		// For the leaf node, the pos_start stores the value.
-		root->pos_start = left->pos_start;
-		root->pos_end = right->pos_start;
-		root->left = left;
-		root->right = right;
-		root->height = 1;
+		p.leaf = false;
+		p.left = left;
+		p.right = right;
+		ResetRange(root);
+		SetLeaf(l.id, left);
+		SetLeaf(r.id, right);
 		return root;
 	}
-	// A non-leaf root
+
+	// A non-leaf root.
+	// Insert to the child which range contains the value, or to
+	// the lower one if the value is between the two children.
+	TreeNode<Id>& p = Node(root);
+	const TreeNode<Id>& left = Node(p.left);
+	const TreeNode<Id>& right = Node(p.right);
+	if (value < right.pos_start
+	        && (value <= MaxValue(left) || left.height <= right.height))
+	{
+		p.left = InsertNode(p.left, id, value);
+	}
 	else
 	{
-
-		// Out of range of left node.
-		if (value < root->pos_start)
-		{
-			// Insert left.
-			root->left = InsertNode(root->left, id, value);
-			root->pos_start = root->left->pos_start;
-			uint16_t left_height = root->left->height;
-			uint16_t right_height = root->right->height;
-			assert(left_height - right_height >= -1);
-			if (left_height - right_height > 1)
-			{
-				return RotateTreeR(root);
-			}
-			else
-			{
-				root->height = std::max(left_height, right_height) + 1;
-				return root;
-			}
-		}
-		// In the range.
-		else if (value < root->pos_end)
-		{
-			// Two leaf children, insert at left.
-			if (root->left->id != kNonID && root->right->id != kNonID)
-			{
-				// Do not need to rotate tree.
-				root->left = InsertNode(root->left, id, value);
-				root->height += 1;
-				return root;
-			}
-
-			// Left child is a non-leaf node.
-			if (root->left->id == kNonID && root->right->id != kNonID)
-			{
-				if (value > root->left->pos_end)
-				{
-					root->right = InsertNode(root->right, id, value);
-					// Now height of right is equal to height of left.
-					return root;
-				}
-				else
-				{
-					root->left = InsertNode(root->left, id, value);
-					// Rotate! Do not need to adjust height.
-					return RotateTreeR(root);
-				}
-			}
-
-			// Right child is a non-leaf node.
-			if (root->left->id != kNonID && root->right->id == kNonID)
-			{
-				if (value < root->right->pos_start)
-				{
-					root->left = InsertNode(root->left, id, value);
-					return root;
-				}
-				else
-				{
-					root->right = InsertNode(root->right, id, value);
-					// Rotate!!
-					return RotateTreeRL(root);
-				}
-			}
-
-			// Two non-leaf children
-			// Insert to the child which range contains the value.
-			uint16_t left_end = root->left->pos_end;
-			uint16_t right_start = root->right->pos_start;
-			if (value < left_end)
-			{
-				// Insert to left child.
-				root->left = InsertNode(root->left, id, value);
-				if (root->left->height - root->right->height > 1)
-				{
-					// Unbalance!! Rotate!!
-					if (root->left->left->height > root->left->right->height)
-					{
-						// Left child is higher, rotate root to right.
-						return RotateTreeR(root);
-					}
-					else
-					{
-						return RotateTreeLR(root);
-					}
-				}
-				else
-				{
-					root->height = std::max(root->left->height, root->right->height) + 1;
-					return root;
-				}
-			}
-			else if (value > right_start)
-			{
-				// Insert to right child.
-				root->right = InsertNode(root->right, id, value);
-				if (root->right->height - root->left->height > 1)
-				{
-					// Unbalance!! Rotate!!
-					if (root->right->right->height > root->right->left->height)
-					{
-						// Right child is higher, rotate root to left.
-						return RotateTreeL(root);
-					}
-					else
-					{
-						return RotateTreeRL(root);
-					}
-				}
-				else
-				{
-					root->height = std::max(root->left->height, root->right->height) + 1;
-					return root;
-				}
-			}
-			// Insert to the less high one if the value is out of range.
-			else
-			{
-				uint16_t lh = root->left->height;
-				uint16_t rh = root->right->height;
-				if (lh < rh)
-				{
-					root->left = InsertNode(root->left, id, value);
-					// height = max(rh, lh + 1)
-				}
-				else if (lh > rh)
-				{
-					root->right = InsertNode(root->right, id, value);
-					// height = max(lh, rh + 1)
-				}
-				else
-				{
-					root->left = InsertNode(root->left, id, value);
-					root->height = root->left->height + 1;
-				}
-				return root;
-			}
-		}
-		// Out of range of right node.
-		else
-		{
-			// Insert right.
-			root->right = InsertNode(root->right, id, value);
-			if (root->right->pos_end != kNonPosition)
-				root->pos_end = root->right->pos_end;
-			else
-				root->pos_end = root->right->pos_start;
-			uint16_t left_height = root->left->height;
-			uint16_t right_height = root->right->height;
-			assert(right_height - left_height >= -1);
-			if (right_height - left_height > 1)
-			{
-				return RotateTreeL(root);
-			}
-			else
-			{
-				root->height = std::max(left_height, right_height) + 1;
-				return root;
-			}
-		}
+		p.right = InsertNode(p.right, id, value);
 	}
+	return Balance(root);
 }
 
-TreeNode* SegmentTree::RemoveNode (TreeNode* root, uint16_t id, float value)
+template <typename Id>
+NodeIndex SegmentTree<Id>::UnlinkLeaf (NodeIndex leaf)
 {
-	// Left child is a leaf node.
-	if (root->left->id == id)
+	// The sibling takes the place of the parent.
+	NodeIndex parent = Node(leaf).parent;
+	const TreeNode<Id>& p = Node(parent);
+	NodeIndex sibling = p.left == leaf ? p.right : p.left;
+	NodeIndex grand = p.parent;
+
+	Node(sibling).parent = grand;
+	if (grand == kNoNode)
+	{
+		root_ = sibling;
+	}
+	else if (Node(grand).left == parent)
 	{
-		TreeNode* pn = root->right;
-		delete root->left;
-		delete root;
-		return pn;
+		Node(grand).left = sibling;
 	}
-	else if (root->right->id == id)
+	else
 	{
-		TreeNode* pn = root->left;
-		delete root->right;
-		delete root;
-		return pn;
+		Node(grand).right = sibling;
 	}
 
-	// In range.
-	if (value <= root->pos_end && value >= root->pos_start)
+	pool_.Free(leaf);
+	pool_.Free(parent);
+	return sibling;
+}
+
+template <typename Id>
+void SegmentTree<Id>::FixUp (NodeIndex node)
+{
+	while (node != kNoNode)
 	{
-		// The removed node is in the left child.
-		if (value <= root->left->pos_end)
+		NodeIndex up = Node(node).parent;
+		NodeIndex sub = Balance(node);
+		Node(sub).parent = up;
+		if (up == kNoNode)
+		{
+			root_ = sub;
+		}
+		else if (Node(up).left == node)
 		{
-			root->left = RemoveNode(root->left, id, value);
-
-			// Unbalance!! Rotate!!
-			if (root->right->height - root->left->height > 1)
-			{
-				if (root->right->left->height > root->right->right->height)
-				{
-					return RotateTreeRL(root);
-				}
-				else
-				{
-					return RotateTreeL(root);
-				}
-			}
-			else
-			{
-				root->pos_start = root->left->pos_start;
-				root->height = 1 + std::max(root->left->height, root->right->height);
-				return root;
-			}
+			Node(up).left = sub;
 		}
-		// The removed node is in the right child.
-		else if (value >= root->right->pos_start)
+		else
 		{
-			root->right = RemoveNode(root->right, id, value);
-
-			// Unbalance!! Rotate!!
-			if (root->left->height - root->right->height > 1)
-			{
-				if (root->left->right->height > root->left->right->height)
-				{
-					return RotateTreeLR(root);
-				}
-				else
-				{
-					return RotateTreeR(root);
-				}
-			}
-			else
-			{
-				if (root->right->id != kNonID)
-				{
-					// A non-leaf child.
-					root->pos_end = root->right->pos_start;
-				}
-				else
-				{
-					root->pos_end = root->right->pos_end;
-				}
-				root->height = 1 + std::max(root->left->height, root->right->height);
-				return root;
-			}
+			Node(up).right = sub;
 		}
+		node = up;
 	}
-
-	// The given value is out of range.
-	return nullptr;
-
 }
 
-TreeNode* SegmentTree::UpdateNode (TreeNode* root, uint16_t id, float cur_val, float new_val)
+template <typename Id>
+void SegmentTree<Id>::FixRanges (NodeIndex leaf)
 {
-	// Out of range.
-	if (cur_val < root->pos_start || cur_val > root->pos_end)
+	for (NodeIndex i = Node(leaf).parent; i != kNoNode; i = Node(i).parent)
 	{
-		return nullptr;
+		TreeNode<Id>& p = Node(i);
+		float start = Node(p.left).pos_start;
+		float end = MaxValue(Node(p.right));
+		if (p.pos_start == start && p.pos_end == end)
+		{
+			break;
+		}
+		p.pos_start = start;
+		p.pos_end = end;
 	}
+}
 
-	// Find it!
-	// Height do not need to change.
-	if (root->left->id == id)
+template <typename Id>
+bool SegmentTree<Id>::ShiftTo (NodeIndex leaf, float value, bool right)
+{
+	// The leaf and the leaves it passes, in the direction of the move.
+	NodeIndex path[kMaxShift + 1];
+	int n = 0;
+	path[n++] = leaf;
+	for (NodeIndex i = leaf;;)
 	{
-		if (new_val <= root->right->pos_start)
+		i = right ? NextLeaf(i) : PrevLeaf(i);
+		if (i == kNoNode || (right ? value <= Node(i).pos_start : value >= Node(i).pos_start))
 		{
-			root->left->pos_start = new_val;
-			root->pos_start = new_val;
-			return root;
+			break;
 		}
-		// The new value is big than the current right node.
-		else
+		if (n > kMaxShift)
 		{
-			// Right child is a leaf node.
-			if (root->right->id != kNonID)
-			{
-				root->left->pos_start = new_val;
-				// Exchange two children.
-				auto pn = root->left;
-				root->left = root->right;
-				root->right = pn;
-				// Set range of the node.
-				root->pos_start = root->left->pos_start;
-				root->pos_end = root->right->pos_start;
-				return root;
-			}
-			// Right child is a non-leaf node
-			else
-			{
-				if (new_val <= root->right->pos_end)
-				{
-					// Exchange node's data.
-					uint16_t old_lid = root->left->id;
-					root->left->pos_start = root->right->pos_start;
-					root->left->id = root->right->left->id;
-					root->right->pos_start = new_val;
-					root->right->left->pos_start = new_val;
-					root->right->left->id = old_lid;
-					// Set range of the root.
-					root->pos_start = root->left->pos_start;
-					root->pos_end = root->right->pos_end;
-					return root;
-				}
-				else
-				{
-					root->left->pos_start = new_val;
-					// Exchange two children.
-					auto pn = root->left;
-					root->left = root->right;
-					root->right = pn;
-					// Set range of the root.
-					root->pos_start = root->left->pos_start;
-					root->pos_end = root->right->pos_start;
-					return root;
-				}
-			}
+			return false;
 		}
+		path[n++] = i;
 	}
-	else if (root->right->id == id)
+
+	// Every leaf takes the payload of the next one,
+	// the last one takes the moved player.
+	Id id = Node(leaf).id;
+	for (int i = 0; i + 1 < n; ++i)
 	{
-		// Left child is a leaf node.
-		if (root->left->id != kNonID)
-		{
-			if (root->left->pos_start <= new_val)
-			{
-				root->right->pos_start = new_val;
-				root->pos_end = new_val;
-			}
-			else
-			{
-				root->right->pos_start = new_val;
-				// Exchange two children.
-				auto pn = root->left;
-				root->left = root->right;
-				root->right = pn;
-				// Set range of the node.
-				root->pos_start = root->left->pos_start;
-				root->pos_end = root->right->pos_start;
-			}
-			return root;
-		}
-		// Right child is a non-leaf node
-		else
-		{
-			if (root->left->pos_end <= new_val)
-			{
-				root->right->pos_start = new_val;
-				root->pos_end = new_val;
-				return root;
-			}
-			else if (root->left->pos_start <= new_val)
-			{
-				// Exchange node's data.
-				uint16_t old_lid = root->right->id;
-				root->right->pos_start = root->left->pos_end;
-				root->right->id = root->left->right->id;
-				root->left->pos_end = new_val;
-				root->left->right->pos_start = new_val;
-				root->left->right->id = old_lid;
-				// Set range of the root.
-				root->pos_start = root->left->pos_start;
-				root->pos_end = root->right->pos_start;
-				return root;
-			}
-			else
-			{
-				root->left->pos_start = new_val;
-				// Exchange two children.
-				auto pn = root->left;
-				root->left = root->right;
-				root->right = pn;
-				// Set range of the root.
-				root->pos_start = root->left->pos_start;
-				root->pos_end = root->right->pos_start;
-				return root;
-			}
-		}
+		TreeNode<Id>& p = Node(path[i]);
+		const TreeNode<Id>& q = Node(path[i + 1]);
+		p.id = q.id;
+		p.pos_start = q.pos_start;
+		leaves_[p.id] = path[i];
 	}
+	Node(path[n - 1]).id = id;
+	Node(path[n - 1]).pos_start = value;
+	leaves_[id] = path[n - 1];
 
+	for (int i = 0; i < n; ++i)
+	{
+		FixRanges(path[i]);
+	}
+	return true;
+}
 
-	// The update node is in left child.
-	if (cur_val <= root->left->pos_end)
+template <typename Id>
+NodeIndex SegmentTree<Id>::PrevLeaf (NodeIndex leaf) const
+{
+	// Up to the first node reached from a right child,
+	// then down the right side of its left child.
+	NodeIndex i = leaf;
+	while (Node(i).parent != kNoNode && Node(Node(i).parent).left == i)
 	{
-		// The node after update is still in left child.
-		if (new_val <= root->right->pos_start)
-		{
-			root->left = UpdateNode(root->left, id, cur_val, new_val);
-			root->pos_start = root->left->pos_start;
-			return root;
-		}
-		else
-		{
-			root = RemoveNode(root, id, cur_val);
-			return InsertNode(root, id, new_val);
-		}
+		i = Node(i).parent;
 	}
-	// The update node is in right child.
-	else if (cur_val >= root->right->pos_start)
+	if (Node(i).parent == kNoNode)
 	{
-		// The node after update is still in right node.
-		if (new_val >= root->left->pos_start)
-		{
-			root->right = UpdateNode(root->right, id, cur_val, new_val);
-			root->pos_end = root->right->pos_end;
-			return root;
-		}
-		else
-		{
-			root = RemoveNode(root, id, cur_val);
-			return InsertNode(root, id, new_val);
-		}
+		return kNoNode;
 	}
+	for (i = Node(Node(i).parent).left; !Node(i).leaf; i = Node(i).right);
+	return i;
+}
 
-	// Out of range.
-	return nullptr;
+template <typename Id>
+NodeIndex SegmentTree<Id>::NextLeaf (NodeIndex leaf) const
+{
+	NodeIndex i = leaf;
+	while (Node(i).parent != kNoNode && Node(Node(i).parent).right == i)
+	{
+		i = Node(i).parent;
+	}
+	if (Node(i).parent == kNoNode)
+	{
+		return kNoNode;
+	}
+	for (i = Node(Node(i).parent).right; !Node(i).leaf; i = Node(i).left);
+	return i;
 }
 
-TreeNode* SegmentTree::RotateTreeR (TreeNode* root)
+template <typename Id>
+NodeIndex SegmentTree<Id>::RotateTreeR (NodeIndex root)
 {
 	// root is a non-leaf node;
-	assert(root->id == kNonID);
-	auto pn = root->left;
-	assert(pn->id == kNonID);
+	assert(!Node(root).leaf);
+	NodeIndex pn = Node(root).left;
+	assert(!Node(pn).leaf);
 
 	// Once assign new value to a node's children, the range of the node need to change.
-	root->left = pn->right;
-	root->pos_start = root->left->pos_start;
-
-	pn->right = root;
-	pn->pos_end = pn->right->pos_end;
+	Node(root).left = Node(pn).right;
+	ResetRange(root);
 
-	// Reset the height.
-	root->height = std::max(root->left->height, root->right->height) + 1;
-	pn->height = std::max(pn->left->height, pn->right->height) + 1;
+	Node(pn).right = root;
+	ResetRange(pn);
 
 	return pn;
 
 }
 
-TreeNode* SegmentTree::RotateTreeL (TreeNode* root)
+template <typename Id>
+NodeIndex SegmentTree<Id>::RotateTreeL (NodeIndex root)
 {
 	// root is a non-leaf node;
-	assert(root->id == kNonID);
-	auto pn = root->right;
-	assert(pn->id == kNonID);
-
-	// Once assign new pointer to a node's children, the range of the node need to change.
-	root->right = pn->left;
-	if (root->right->pos_end != kNonPosition)
-		root->pos_end = root->right->pos_end;
-	else
-		root->pos_end = root->right->pos_start;
+	assert(!Node(root).leaf);
+	NodeIndex pn = Node(root).right;
+	assert(!Node(pn).leaf);
 
-	pn->left = root;
-	pn->pos_start = pn->left->pos_start;
+	// Once assign new child to a node, the range of the node need to change.
+	Node(root).right = Node(pn).left;
+	ResetRange(root);
 
-	// Reset the height.
-	root->height = std::max(root->left->height, root->right->height) + 1;
-	pn->height = std::max(pn->left->height, pn->right->height) + 1;
+	Node(pn).left = root;
+	ResetRange(pn);
 
 	return pn;
 
 }
 
-TreeNode* SegmentTree::RotateTreeRL (TreeNode* root)
+template <typename Id>
+NodeIndex SegmentTree<Id>::RotateTreeRL (NodeIndex root)
 {
 	// Rotate right child with right first.
-	root->right = RotateTreeR(root->right);
+	NodeIndex right = RotateTreeR(Node(root).right);
+	Node(root).right = right;
 
 	// Then rotate root with left.
 	return RotateTreeL(root);
 }
 
-TreeNode* SegmentTree::RotateTreeLR (TreeNode* root)
+template <typename Id>
+NodeIndex SegmentTree<Id>::RotateTreeLR (NodeIndex root)
 {
 	// Rotate left child with left first.
-	root->left = RotateTreeL(root->left);
+	NodeIndex left = RotateTreeL(Node(root).left);
+	Node(root).left = left;
 
 	// Then rotate root with right.
 	return RotateTreeR(root);
 }
 
-// endregion private method
\ No newline at end of file
+// endregion private method
+
+template class ysd_bes_aoi::SegmentTree<uint16_t>;
+template class ysd_bes_aoi::SegmentTree<uint32_t>;
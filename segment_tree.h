@@ -11,206 +11,433 @@
 #include <queue>
 #include <algorithm>
 #include <assert.h>
+#include "node_pool.h"
+#include "flat_layout.h"
+#include "radix_sort.h"
+
+// 1 to count nodes visited and rotations. They are in the
+// hottest loops, so they are left out of normal builds.
+#ifndef AOI_STATS
+#define AOI_STATS 0
+#endif
+
+#if AOI_STATS
+#define AOI_STAT(expr) (expr)
+#else
+#define AOI_STAT(expr) ((void)0)
+#endif
 
 namespace ysd_bes_aoi
 {
 
-	const uint16_t kNonID 		= 10000;
 	const float kNonPosition 	= -99999;
 
+	// Number of tree walks on an unchanged tree before
+	// Search switches to the flat layout.
+	const int kFlattenAfterSearches = 4;
+
+	// Most leaves an update shifts along instead of
+	// removing and inserting the leaf again.
+	const int kMaxShift = 8;
+
+	// Counters and health of a tree.
+	struct TreeStats
+	{
+		// Updates that only changed the value of the leaf.
+		uint64_t update_in_place;
+
+		// Updates that shifted a few neighbour leaves along.
+		uint64_t update_shifted;
+
+		// Updates that removed and inserted the leaf again.
+		uint64_t update_reinserted;
+
+		// Searches by walking the tree and by the flat layout,
+		// and nodes visited by the walks. Only if AOI_STATS.
+		uint64_t search_walks;
+		uint64_t search_flat;
+		uint64_t nodes_visited;
+
+		// Rotations done by Balance, by kind. Only if AOI_STATS.
+		uint64_t rotations_r;
+		uint64_t rotations_l;
+		uint64_t rotations_rl;
+		uint64_t rotations_lr;
+
+		// Height of the root, and of a perfect tree of as many leaves.
+		uint32_t height;
+		uint32_t ideal_height;
+
+		// Number of leaves.
+		uint32_t leaves;
+
+		// Nodes in use, and memory of the tree and its flat layout in bytes.
+		uint64_t nodes;
+		uint64_t bytes;
+	};
+
+	// A node of the tree, for player ids of type Id.
+	// Nodes are linked by their slots in the pool of the
+	// tree, so the node is 28 bytes with 16 bit ids and
+	// 32 bytes with 32 bit ids, on any target.
+	template <typename Id>
 	struct TreeNode
 	{
 
 		TreeNode ( ) :
-			id (kNonID), pos_start (kNonPosition), pos_end (kNonPosition) , height (0)
+			left (kNoNode), right (kNoNode), parent (kNoNode), pos_start (kNonPosition), pos_end (kNonPosition), count (1), id (0), height (0), leaf (true)
 		{
 
 		}
 
-		TreeNode* left;
-		TreeNode* right;
+		NodeIndex left;
+		NodeIndex right;
 
-		// If this is a leaf node, this property will be 10000.
-		uint16_t id;
+		// kNoNode if root node.
+		NodeIndex parent;
 
 		// If this is a leaf node, this property will be the value of X/Y coordinate.
 		float pos_start;
 
-		// If this is a leaf node, this property will be 0.0f.
+		// If this is a leaf node, this property will be kNonPosition.
 		float pos_end;
 
+		// Number of leaves in the tree, 1 if leaf node.
+		uint32_t count;
+
+		// Player id of a leaf node, unused for a non-leaf node.
+		Id id;
+
 		// 0 if leaf node
-		uint16_t height;
+		uint8_t height;
+
+		// If this is a leaf node.
+		bool leaf;
 	};
 
+	static_assert(sizeof(TreeNode<uint16_t>) == 28, "TreeNode<uint16_t> is not 28 bytes");
+	static_assert(sizeof(TreeNode<uint32_t>) == 32, "TreeNode<uint32_t> is not 32 bytes");
+
 	///////////////////////////////////////////////////
 	// Segment tree to manage a 2d game scene.
 	// The non-leaf node represent a range of its child
 	// nodes; the leaf node represent the X/Y coordinates
-	// of a position of a player.
+	// of a position of a player. The leaf of every id is
+	// kept, so a remove or update starts from the leaf
+	// and fixes the tree bottom up.
+	// Instantiated for uint16_t and uint32_t player ids.
 	///////////////////////////////////////////////////
+	template <typename Id>
 	class SegmentTree final
 	{
 	public:
 
+		SegmentTree ( ) :
+			root_ (kNoNode), stats_ (), flat_valid_ (false), walks_since_change_ (0)
+		{
+
+		}
+
+		SegmentTree (const SegmentTree&) = delete;
+		SegmentTree& operator= (const SegmentTree&) = delete;
+
 		// Create segment tree with given coordinates and IDs.
+		// Nodes are allocated from this tree's pool.
 		// @param[in]	i 	Index of the start position in the input data.
 		// @param[in]	j 	Index after the start position in the input data.
-		static TreeNode* CreateSegmentTree (float* values, uint16_t* ids, int i, int j);
+		// @return 	Slot of the root of the new tree.
+		NodeIndex CreateSegmentTree (float* values, Id* ids, int i, int j);
+
+		// Replace the whole tree with the given nodes.
+		// The data is sorted and the tree built bottom up in one
+		// step, which is much faster than inserting one by one.
+		// @param[in]	values 	X/Y coordinates, in any order.
+		// @param[in]	ids 	Player ids, in the same order of values.
+		// @param[in]	n 		Number of nodes.
+		void Load (const float* values, const Id* ids, size_t n);
+
+		// The same as Load, for values already sorted, as the flat
+		// layout of a tree keeps them. No sort, only one linear pass.
+		void LoadSorted (const float* values, const Id* ids, size_t n);
+
+		// Drop all nodes at once. Memory is kept for reuse.
+		void Clear ( )
+		{
+			root_ = kNoNode;
+			pool_.Reset();
+			std::fill(leaves_.begin(), leaves_.end(), kNoNode);
+			Invalidate();
+		}
+
+		// Drop all nodes and give the memory back.
+		void Release ( )
+		{
+			root_ = kNoNode;
+			pool_.Release();
+			std::vector<NodeIndex>().swap(leaves_);
+			Invalidate();
+			flat_ = FlatLayout<Id>();
+			std::vector<NodeIndex>().swap(flat_stack_);
+			std::vector<float>().swap(flat_values_);
+			std::vector<Id>().swap(flat_ids_);
+		}
+
+		// Rebuild the flat layout from the current tree.
+		// Search uses it until the next change of the tree.
+		void Flatten ( );
+
+		// The flat layout, rebuilt first if it is out of date.
+		const FlatLayout<Id>& Flat ( )
+		{
+			if (!flat_valid_)
+			{
+				Flatten();
+			}
+			return flat_;
+		}
 
 		// Print the tree by layer.
 		void Print ( )
 		{
-			PrintLayer(root_);
+			if (root_ != kNoNode)
+			{
+				PrintLayer(root_);
+			}
 		}
 
 		// For a given range [start, end], get ids of
 		// those position that which X/Y coordinate in.
+		// The flat layout is used if it is up to date, and is
+		// rebuilt once the tree stays unchanged for a few searches.
 		// @param[in]	start 	Search range.
 		// @param[in]	end 	Search range.
 		// @param[out]	result	Search result set.
-		void Search (const float start, const float end, std::vector<uint16_t>& result)
+		void Search (const float start, const float end, std::vector<Id>& result)
 		{
-			if (root_ == nullptr)
+			if (root_ == kNoNode)
+			{
+				return;
+			}
+
+			if (!flat_valid_ && ++walks_since_change_ >= kFlattenAfterSearches)
+			{
+				Flatten();
+			}
+
+			if (flat_valid_)
 			{
+				AOI_STAT(++stats_.search_flat);
+				flat_.Search(start, end, result);
 				return;
 			}
 
+			AOI_STAT(++stats_.search_walks);
 			SearchRange(root_, start, end, result);
 		}
 
+		// For a given range [start, end], get the number of
+		// positions which X/Y coordinate in, in O(logn).
+		// @param[in]	start 	Search range.
+		// @param[in]	end 	Search range.
+		size_t Count (const float start, const float end) const
+		{
+			if (root_ == kNoNode)
+			{
+				return 0;
+			}
+			if (flat_valid_)
+			{
+				return flat_.Count(start, end);
+			}
+			return CountRange(root_, start, end);
+		}
+
+		// Number of nodes in the tree.
+		size_t size ( ) const
+		{
+			return root_ == kNoNode ? 0 : Node(root_).count;
+		}
+
 		// Insert a node with given id and value.
-		// @param[in]	id 		New node's player id.
+		// @param[in]	id 		New node's player id, must not be in the tree.
 		// @param[in]	value	New node's player X/Y coordinate.
-		void Insert (uint16_t id, float value)
+		void Insert (Id id, float value)
 		{
+			Invalidate();
 			root_ = InsertNode(root_, id, value);
+			Node(root_).parent = kNoNode;
 		}
 
-		// Remove a node with given id.
+		// Remove the node of the given id.
 		// @param[in]	id 		Removed node's player id.
-		// @param[in]	value 	X/Y coordinate to search the node.
-		bool Remove (uint16_t id, float value)
-		{
-			if (id == root_->id)
-			{
-				// The last node.
-				delete root_;
-				root_ = nullptr;
-				return true;
-			}
-			TreeNode* new_root = RemoveNode(root_, id, value);
-			if (new_root != nullptr)
-			{
-				root_ = new_root;
-				return true;
-			}
-			return false;
-		}
+		// @return 	False if the id is not in the tree.
+		bool Remove (Id id);
 
-		// Change a node's value with the given id.
+		// Change the value of the node of the given id. A small move
+		// that stays between the neighbour leaves only changes the
+		// leaf, one that passes a few leaves shifts them along, and
+		// only a bigger one removes and inserts the leaf again.
 		// @param[in]	id 		Changed node's player id.
-		// @param[in]	cur_val	Changed node's current value that used to find it in the tree.
 		// @param[in]	new_val The new value after update.
-		bool Update (uint16_t id, float cur_val, float new_val)
-		{
-			// When there is only one node.
-			if (root_->id != kNonID)
-			{
-				if (root_->id == id)
-				{
-					root_->pos_start = new_val;
-					return true;
-				}
-				return false;
-			}
-
-			if (cur_val > root_->pos_end || cur_val < root_->pos_start)
-			{
-				return false;
-			}
+		// @return 	False if the id is not in the tree.
+		bool Update (Id id, float new_val);
 
-			TreeNode* new_root = UpdateNode(root_, id, cur_val, new_val);
-			if (new_root != nullptr)
-			{
-				root_ = new_root;
-				return true;
-			}
-			return false;
-		}
+		// Get the counters, and the health of the tree now.
+		TreeStats stats ( ) const;
 
 		bool Range (float* start, float* end) 
 		{
-			if (root_ == nullptr || root_->id != kNonID)
+			if (root_ == kNoNode || Node(root_).leaf)
 			{
 				return false;
 			}
-			*start = root_->pos_start;
-			*end = root_->pos_end;
+			*start = Node(root_).pos_start;
+			*end = Node(root_).pos_end;
 			return true;
 		}
 
 	private:
 
+		// The node in a slot of the pool.
+		TreeNode<Id>& Node (NodeIndex i)
+		{
+			return pool_.Get(i);
+		}
+
+		const TreeNode<Id>& Node (NodeIndex i) const
+		{
+			return pool_.Get(i);
+		}
+
+		// Build the tree and the flat layout from the sorted
+		// leaves in flat_values_ and flat_ids_.
+		void BuildSorted ( );
+
+		// Mark the flat layout out of date.
+		void Invalidate ( )
+		{
+			flat_valid_ = false;
+			walks_since_change_ = 0;
+		}
+
 		// For a given range [start, end], get ids of
 		// those position that which X/Y coordinate in.
 		// @param[in]		root 	The tree we search.
 		// @param[in]		start 	Search range.
 		// @param[in]		end 	Search range.
 		// @param[in, out]	result	Search result set.
-		void SearchRange (const TreeNode* root, const float start, const float end, std::vector<uint16_t>& result);
+		void SearchRange (NodeIndex root, const float start, const float end, std::vector<Id>& result);
 
-		// Update the value of a node with given id
-		TreeNode* UpdateNode (TreeNode* root, uint16_t id, float cur_val, float new_val);
+		// Count the leaves in the range [start, end]. Subtrees
+		// entirely in the range are counted without going down.
+		size_t CountRange (NodeIndex root, const float start, const float end) const;
 
 		// Insert a node with given id and value.
-		// @return 	Pointer to the inserted tree.
-		TreeNode* InsertNode (TreeNode* root, uint16_t id, float value);
+		// @return 	Slot of the root of the inserted tree.
+		NodeIndex InsertNode (NodeIndex root, Id id, float value);
+
+		// Unlink a leaf and its parent from the tree, and free them.
+		// @return 	The node that took the place of the parent.
+		NodeIndex UnlinkLeaf (NodeIndex leaf);
+
+		// Rebalance and reset the ranges from a node up to the root.
+		void FixUp (NodeIndex node);
+
+		// Reset the ranges above a leaf which value changed, up to
+		// the first one that stays the same.
+		void FixRanges (NodeIndex leaf);
+
+		// Move a leaf to the value by shifting the payloads of the
+		// leaves it passes one leaf back, if there are few of them.
+		// @return 	False if it passes more than kMaxShift leaves.
+		bool ShiftTo (NodeIndex leaf, float value, bool right);
+
+		// The leaf before or after a leaf in order, or kNoNode.
+		NodeIndex PrevLeaf (NodeIndex leaf) const;
+		NodeIndex NextLeaf (NodeIndex leaf) const;
+
+		// The leaf of a player id, or kNoNode.
+		NodeIndex LeafOf (Id id) const
+		{
+			return id < leaves_.size() ? leaves_[id] : kNoNode;
+		}
 
-		// Remove a node with given id and value.
-		// @return 	Pointer to the handled node.
-		TreeNode* RemoveNode (TreeNode* root, uint16_t id, float value);
+		// Record the leaf of a player id.
+		void SetLeaf (Id id, NodeIndex leaf)
+		{
+			if (id >= leaves_.size())
+			{
+				leaves_.resize(std::max<size_t>(id + 1, 2 * leaves_.size()), kNoNode);
+			}
+			leaves_[id] = leaf;
+		}
+
+		// Biggest X/Y coordinate in the tree.
+		static float MaxValue (const TreeNode<Id>& root)
+		{
+			return root.leaf ? root.pos_start : root.pos_end;
+		}
+
+		// Reset range, height and count of a non-leaf node from its
+		// children, and make it their parent.
+		void ResetRange (NodeIndex root)
+		{
+			TreeNode<Id>& p = Node(root);
+			TreeNode<Id>& left = Node(p.left);
+			TreeNode<Id>& right = Node(p.right);
+			left.parent = root;
+			right.parent = root;
+			p.pos_start = left.pos_start;
+			p.pos_end = MaxValue(right);
+			p.height = std::max(left.height, right.height) + 1;
+			p.count = left.count + right.count;
+		}
+
+		// Rotate the tree if it is unbalance, and reset its range.
+		// @param[in] 	root 	A non-leaf node which children are balanced.
+		// @return		New root of the tree.
+		NodeIndex Balance (NodeIndex root);
 
 		// Rotate the tree right.
-		// @param[in] 	root 	The pointer to the unbalance node
+		// @param[in] 	root 	The slot of the unbalance node
 		// @return		New root of the rotated tree.
-		TreeNode* RotateTreeR (TreeNode* root);
+		NodeIndex RotateTreeR (NodeIndex root);
 
 		// Rotate the tree left.
-		// @param[in] 	root 	The pointer to the unbalance node
+		// @param[in] 	root 	The slot of the unbalance node
 		// @return		New root of the rotated tree.
-		TreeNode* RotateTreeL (TreeNode* root);
+		NodeIndex RotateTreeL (NodeIndex root);
 
 		// Rotate the tree right than rotate left.
-		// @param[in] 	root 	The pointer to the unbalance node
+		// @param[in] 	root 	The slot of the unbalance node
 		// @return		New root of the rotated tree.
-		TreeNode* RotateTreeRL (TreeNode* root);
+		NodeIndex RotateTreeRL (NodeIndex root);
 
 		// Rotate the tree left than rotate right.
-		// @param[in] 	root 	The pointer to the unbalance node
+		// @param[in] 	root 	The slot of the unbalance node
 		// @return		New root of the rotated tree.
-		TreeNode* RotateTreeLR (TreeNode* root);
+		NodeIndex RotateTreeLR (NodeIndex root);
 
 		// Print by layer.
-		void PrintLayer (TreeNode *root)
+		void PrintLayer (NodeIndex root)
 		{
-			std::queue<TreeNode*> q;
+			std::queue<NodeIndex> q;
 			q.push(root);
 			int count = 1;
 			while (!q.empty())
 			{
-				TreeNode* p = q.front();
+				const TreeNode<Id>& p = Node(q.front());
 				q.pop();
-				if (p->id == kNonID)
+				if (!p.leaf)
 				{
-					std::cout << "(" << (p->pos_start) << "," << (p->pos_end) << "), ";
-					q.push(p->left);
-					q.push(p->right);
+					std::cout << "(" << (p.pos_start) << "," << (p.pos_end) << "), ";
+					q.push(p.left);
+					q.push(p.right);
 				}
 				else
 				{
-					std::cout << "v:" << (p->pos_start)
-					          << "i:"  << (p->id)
+					std::cout << "v:" << (p.pos_start)
+					          << "i:"  << (p.id)
 					          << ", ";
 				}
 
@@ -223,7 +450,29 @@ namespace ysd_bes_aoi
 			}
 		}
 
-		TreeNode* root_;
+		NodeIndex root_;
+
+		// All nodes of the tree live here.
+		NodePool<TreeNode<Id>> pool_;
+
+		// Leaf of every player id, indexed by id.
+		std::vector<NodeIndex> leaves_;
+
+		TreeStats stats_;
+
+		// Sorted copy of the leaves for fast search.
+		FlatLayout<Id> flat_;
+
+		// If flat_ matches the tree.
+		bool flat_valid_;
+
+		// Searches done by walking the tree since the last change.
+		int walks_since_change_;
+
+		// Scratch buffers of Flatten.
+		std::vector<NodeIndex> flat_stack_;
+		std::vector<float> flat_values_;
+		std::vector<Id> flat_ids_;
 
 	};
 }
@@ -0,0 +1,305 @@
+//////////////////////////////////////////////////
+// @fileoverview A scene split into strips along x,
+//				 each searched and updated by its own
+//				 thread.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <math.h>
+#include <algorithm>
+#include "sharded_scene.h"
+
+using namespace ysd_bes_aoi;
+
+const size_t ShardedScene::kMaxShards;
+const size_t ShardedScene::kParallelSearch;
+const uint16_t ShardedScene::kNoShard;
+const uint16_t ShardedScene::kMigrating;
+
+// region public method
+
+ShardedScene::ShardedScene (size_t shards, float strip_width, size_t threads) :
+	strip_width_ (strip_width), pool_ (threads)
+{
+	shards_.resize(shards < 1 ? 1 : shards > kMaxShards ? kMaxShards : shards);
+	for (auto& shard : shards_)
+	{
+		shard.reset(new Scene());
+	}
+	found_.resize(shards_.size());
+	moves_.resize(shards_.size());
+	many_rects_.resize(shards_.size());
+	many_index_.resize(shards_.size());
+	many_offsets_.resize(shards_.size());
+	many_ids_.resize(shards_.size());
+}
+
+bool ShardedScene::Insert (AoiId id, float x_pos, float y_pos)
+{
+	if (id >= PositionStore::kMaxIds)
+	{
+		return false;
+	}
+	if (id >= shard_of_.size())
+	{
+		size_t n = std::max<size_t>(id + 1, 2 * shard_of_.size());
+		shard_of_.resize(n < PositionStore::kMaxIds ? n : PositionStore::kMaxIds, kNoShard);
+	}
+	if (shard_of_[id] != kNoShard)
+	{
+		return false;
+	}
+
+	size_t shard = ShardOf(x_pos);
+	shards_[shard]->Insert(id, x_pos, y_pos);
+	shard_of_[id] = shard;
+	++size_;
+	return true;
+}
+
+bool ShardedScene::Remove (AoiId id)
+{
+	if (id >= shard_of_.size() || shard_of_[id] == kNoShard)
+	{
+		return false;
+	}
+	shards_[shard_of_[id]]->Remove(id);
+	shard_of_[id] = kNoShard;
+	--size_;
+	return true;
+}
+
+bool ShardedScene::Update (AoiId id, float x_pos, float y_pos)
+{
+	if (id >= shard_of_.size() || shard_of_[id] == kNoShard)
+	{
+		return false;
+	}
+
+	size_t from = shard_of_[id] & ~kMigrating;
+	size_t to = ShardOf(x_pos);
+	if (from == to)
+	{
+		return shards_[from]->Update(id, x_pos, y_pos);
+	}
+
+	// Across a border, move the player to the other strip.
+	shards_[from]->Remove(id);
+	shards_[to]->Insert(id, x_pos, y_pos);
+	shard_of_[id] = to;
+	return true;
+}
+
+void ShardedScene::UpdateMany (const AoiId* ids, const float* xs, const float* ys, size_t n, std::vector<uint8_t>& updated)
+{
+	updated.assign(n, 0);
+	for (auto& moves : moves_)
+	{
+		moves.clear();
+	}
+	migrations_.clear();
+
+	// Sort the moves out by strip. Once a player crosses a border
+	// in this batch, all its later moves are made in order after
+	// the moves inside the strips.
+	for (size_t i = 0; i < n; ++i)
+	{
+		AoiId id = ids[i];
+		if (id >= shard_of_.size() || shard_of_[id] == kNoShard)
+		{
+			continue;
+		}
+		uint16_t shard = shard_of_[id];
+		if (!(shard & kMigrating) && ShardOf(xs[i]) == shard)
+		{
+			moves_[shard].push_back(i);
+		}
+		else
+		{
+			migrations_.push_back(i);
+			shard_of_[id] |= kMigrating;
+		}
+	}
+
+	// Each strip is changed by one thread only.
+	pool_.ParallelFor(shards_.size(), [&] (size_t shard)
+	{
+		for (uint32_t i : moves_[shard])
+		{
+			updated[i] = shards_[shard]->Update(ids[i], xs[i], ys[i]);
+		}
+	});
+
+	for (uint32_t i : migrations_)
+	{
+		updated[i] = Update(ids[i], xs[i], ys[i]);
+	}
+	for (uint32_t i : migrations_)
+	{
+		shard_of_[ids[i]] &= ~kMigrating;
+	}
+}
+
+const std::vector<AoiId>& ShardedScene::Search (float x_start, float x_end, float y_start, float y_end)
+{
+	hits_.clear();
+	if (!(x_end >= x_start) || !(y_end >= y_start))
+	{
+		return hits_;
+	}
+
+	size_t first, last;
+	ShardsOf(x_start, x_end, &first, &last);
+	auto search = [&] (size_t i)
+	{
+		found_[i] = &shards_[first + i]->Search(x_start, x_end, y_start, y_end);
+	};
+
+	// Spread over the threads only if there is enough to find.
+	size_t estimate = 0;
+	for (size_t s = first; s <= last && last > first && pool_.threads() > 0; ++s)
+	{
+		estimate += shards_[s]->Count(x_start, x_end, y_start, y_end, false);
+	}
+	if (estimate >= kParallelSearch)
+	{
+		pool_.ParallelFor(last - first + 1, search);
+	}
+	else
+	{
+		for (size_t i = 0; i <= last - first; ++i)
+		{
+			search(i);
+		}
+	}
+
+	for (size_t i = 0; i <= last - first; ++i)
+	{
+		hits_.insert(hits_.end(), found_[i]->begin(), found_[i]->end());
+	}
+	return hits_;
+}
+
+void ShardedScene::SearchMany (const float* rects, size_t n, std::vector<uint32_t>& offsets, std::vector<AoiId>& ids)
+{
+	// Hand every range to the strips it overlaps.
+	for (size_t s = 0; s < shards_.size(); ++s)
+	{
+		many_rects_[s].clear();
+		many_index_[s].clear();
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		const float* r = rects + 4 * i;
+		if (!(r[1] >= r[0]) || !(r[3] >= r[2]))
+		{
+			continue;
+		}
+		size_t first, last;
+		ShardsOf(r[0], r[1], &first, &last);
+		for (size_t s = first; s <= last; ++s)
+		{
+			many_rects_[s].insert(many_rects_[s].end(), r, r + 4);
+			many_index_[s].push_back(i);
+		}
+	}
+
+	pool_.ParallelFor(shards_.size(), [&] (size_t s)
+	{
+		// A strip with no range must not flatten its trees for nothing.
+		if (many_index_[s].empty())
+		{
+			many_offsets_[s].assign(1, 0);
+			many_ids_[s].clear();
+			return;
+		}
+		shards_[s]->SearchMany(many_rects_[s].data(), many_index_[s].size(), many_offsets_[s], many_ids_[s]);
+	});
+
+	// Merge by range, the strips in order.
+	offsets.assign(n + 1, 0);
+	for (size_t s = 0; s < shards_.size(); ++s)
+	{
+		for (size_t k = 0; k < many_index_[s].size(); ++k)
+		{
+			offsets[many_index_[s][k] + 1] += many_offsets_[s][k + 1] - many_offsets_[s][k];
+		}
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	ids.resize(offsets[n]);
+	many_cursor_.assign(offsets.begin(), offsets.end() - 1);
+	for (size_t s = 0; s < shards_.size(); ++s)
+	{
+		const std::vector<AoiId>& found = many_ids_[s];
+		for (size_t k = 0; k < many_index_[s].size(); ++k)
+		{
+			uint32_t& cursor = many_cursor_[many_index_[s][k]];
+			std::copy(found.begin() + many_offsets_[s][k], found.begin() + many_offsets_[s][k + 1], ids.begin() + cursor);
+			cursor += many_offsets_[s][k + 1] - many_offsets_[s][k];
+		}
+	}
+}
+
+size_t ShardedScene::Count (float x_start, float x_end, float y_start, float y_end, bool exact)
+{
+	if (!(x_end >= x_start) || !(y_end >= y_start))
+	{
+		return 0;
+	}
+
+	size_t first, last;
+	ShardsOf(x_start, x_end, &first, &last);
+	size_t count = 0;
+	for (size_t s = first; s <= last; ++s)
+	{
+		count += shards_[s]->Count(x_start, x_end, y_start, y_end, exact);
+	}
+	return count;
+}
+
+void ShardedScene::Close ( )
+{
+	for (auto& shard : shards_)
+	{
+		shard->Close();
+	}
+	std::vector<uint16_t>().swap(shard_of_);
+	size_ = 0;
+	std::vector<AoiId>().swap(hits_);
+	for (size_t s = 0; s < shards_.size(); ++s)
+	{
+		std::vector<uint32_t>().swap(moves_[s]);
+		std::vector<float>().swap(many_rects_[s]);
+		std::vector<uint32_t>().swap(many_index_[s]);
+		std::vector<uint32_t>().swap(many_offsets_[s]);
+		std::vector<AoiId>().swap(many_ids_[s]);
+	}
+	std::vector<uint32_t>().swap(migrations_);
+	std::vector<uint32_t>().swap(many_cursor_);
+}
+
+// endregion public method
+
+// region private method
+
+size_t ShardedScene::ShardOf (float x_pos) const
+{
+	float strip = floorf(x_pos / strip_width_);
+	if (!(strip > 0))
+	{
+		return 0;
+	}
+	return strip >= shards_.size() - 1 ? shards_.size() - 1 : static_cast<size_t>(strip);
+}
+
+void ShardedScene::ShardsOf (float x_start, float x_end, size_t* first, size_t* last) const
+{
+	*first = ShardOf(x_start);
+	*last = ShardOf(x_end);
+}
+
+// endregion private method
@@ -0,0 +1,156 @@
+//////////////////////////////////////////////////
+// @fileoverview A scene split into strips along x,
+//				 searched and updated on a pool of
+//				 threads.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _SHARDED_SCENE_H_
+#define _SHARDED_SCENE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+#include "scene.h"
+#include "worker_pool.h"
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// The world cut into strips of the same width along
+	// x, each one a Scene with its own trees. A player
+	// lives in the strip of its x coordinate and moves
+	// to another one when it crosses a border. A search
+	// only looks at the strips its range overlaps, and
+	// big searches and batches run the strips in
+	// parallel on a pool of threads.
+	///////////////////////////////////////////////////
+	class ShardedScene final
+	{
+	public:
+
+		// Most strips of a scene.
+		static const size_t kMaxShards = 1024;
+
+		// Estimated players a search must find to be spread over
+		// the threads. Not tuned on many cores yet.
+		static const size_t kParallelSearch = 2048;
+
+		// @param[in]	shards 		Number of strips, 1 to kMaxShards.
+		// @param[in]	strip_width	Width of a strip. Strip i holds x in
+		//							[i * strip_width, (i + 1) * strip_width),
+		//							the first and last ones reach to infinity.
+		// @param[in]	threads 	Worker threads besides the calling one.
+		ShardedScene (size_t shards, float strip_width, size_t threads);
+
+		ShardedScene (const ShardedScene&) = delete;
+		ShardedScene& operator= (const ShardedScene&) = delete;
+
+		// Add a player to the strip of its position.
+		// @return 	False if the id is already in the scene, or not
+		//			less than PositionStore::kMaxIds.
+		bool Insert (AoiId id, float x_pos, float y_pos);
+
+		// Remove a player.
+		// @return 	False if the id is not in the scene.
+		bool Remove (AoiId id);
+
+		// Move a player, to another strip if it crosses a border.
+		// @return 	False if the id is not in the scene.
+		bool Update (AoiId id, float x_pos, float y_pos);
+
+		// Move many players. Moves inside a strip are made by the
+		// strips in parallel, then the ones across a border in order.
+		// The result is the same as calling Update in order.
+		// @param[out]	updated 	For every move, 1 if the id is in the scene.
+		void UpdateMany (const AoiId* ids, const float* xs, const float* ys, size_t n, std::vector<uint8_t>& updated);
+
+		// Search players in a given square range, with the same
+		// bounds as Scene::Search.
+		// @return 	Ids of the players found, by strip, valid until
+		//			the next search.
+		const std::vector<AoiId>& Search (float x_start, float x_end, float y_start, float y_end);
+
+		// Search players in many square ranges at once. Every strip
+		// runs Scene::SearchMany on the ranges overlapping it, in
+		// parallel, then the results are merged by range.
+		// @param[in]	rects 	(x_start, x_end, y_start, y_end) of every range.
+		// @param[in]	n 		Number of ranges.
+		// @param[out]	offsets	n + 1 offsets into ids, as Scene::SearchMany.
+		// @param[out]	ids 	Ids of the players found, in the order of the ranges.
+		void SearchMany (const float* rects, size_t n, std::vector<uint32_t>& offsets, std::vector<AoiId>& ids);
+
+		// Count players in a given square range, see Scene::Count.
+		size_t Count (float x_start, float x_end, float y_start, float y_end, bool exact = true);
+
+		// Number of players.
+		size_t size ( ) const
+		{
+			return size_;
+		}
+
+		// Number of strips.
+		size_t shards ( ) const
+		{
+			return shards_.size();
+		}
+
+		// Number of players in a strip.
+		size_t ShardSize (size_t shard) const
+		{
+			return shards_[shard]->size();
+		}
+
+		// Remove all players and give the memory back.
+		void Close ( );
+
+	private:
+
+		// The strip no player is in.
+		static const uint16_t kNoShard = 0xffff;
+
+		// Marks a player moved across a border in the current
+		// UpdateMany, so its later moves keep their order.
+		static const uint16_t kMigrating = 0x8000;
+
+		// The strip of an x coordinate.
+		size_t ShardOf (float x_pos) const;
+
+		// The strips a range [x_start, x_end] overlaps.
+		void ShardsOf (float x_start, float x_end, size_t* first, size_t* last) const;
+
+		std::vector<std::unique_ptr<Scene>> shards_;
+
+		const float strip_width_;
+
+		// The strip of every player, indexed by id.
+		std::vector<uint16_t> shard_of_;
+
+		size_t size_ = 0;
+
+		WorkerPool pool_;
+
+		// Ids of the last search result, reused by every search.
+		std::vector<AoiId> hits_;
+
+		// What every strip of the last search found.
+		std::vector<const std::vector<AoiId>*> found_;
+
+		// Scratch buffers of UpdateMany: the moves inside every strip,
+		// and the ones across a border.
+		std::vector<std::vector<uint32_t>> moves_;
+		std::vector<uint32_t> migrations_;
+
+		// Scratch buffers of SearchMany: for every strip the ranges
+		// overlapping it, their index, and what the strip found.
+		std::vector<std::vector<float>> many_rects_;
+		std::vector<std::vector<uint32_t>> many_index_;
+		std::vector<std::vector<uint32_t>> many_offsets_;
+		std::vector<std::vector<AoiId>> many_ids_;
+		std::vector<uint32_t> many_cursor_;
+	};
+}
+
+#endif
@@ -0,0 +1,245 @@
+//////////////////////////////////////////////////
+// @fileoverview Save and restore of a scene as a
+//				 binary snapshot, see snapshot.h.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include "scene.h"
+
+using namespace ysd_bes_aoi;
+
+static size_t AlignUp (size_t n)
+{
+	return (n + kSnapshotAlign - 1) & ~(kSnapshotAlign - 1);
+}
+
+// Write n bytes, then zeros up to the next section.
+static bool WriteSection (FILE* file, const void* data, size_t n)
+{
+	static const char zeros[kSnapshotAlign] = {};
+	return fwrite(data, 1, n, file) == n && fwrite(zeros, 1, AlignUp(n) - n, file) == AlignUp(n) - n;
+}
+
+// Check the leaves of a tree in a snapshot: sorted, every player
+// once, and the same coordinates as the position arrays.
+// @param[in]	values 	Coordinates of the leaves.
+// @param[in]	coords 	Coordinates of the players, indexed by id.
+// @param[in]	seen 	Zeroed bitmap as long as alive, as scratch.
+static bool CheckLeaves (const float* values, const AoiId* ids, size_t n, const float* coords,
+                         const uint64_t* alive, uint64_t ids_len, std::vector<uint64_t>& seen)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		AoiId id = ids[i];
+		uint64_t bit = uint64_t(1) << (id & 63);
+		if (id >= ids_len || !(alive[id >> 6] & bit) || (seen[id >> 6] & bit)
+		        || memcmp(&values[i], &coords[id], sizeof(float)) != 0 || (i > 0 && values[i] < values[i - 1]))
+		{
+			return false;
+		}
+		seen[id >> 6] |= bit;
+	}
+	return true;
+}
+
+// region public method
+
+bool Scene::Save (const char* path)
+{
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kSnapshotMagic;
+	header.version = kSnapshotVersion;
+	header.id_bytes = sizeof(AoiId);
+	header.players = positions_.size();
+	header.ids = positions_.capacity();
+
+	const void* data[kSnapshotSections] = {};
+	data[kSnapshotXs] = positions_.xs();
+	data[kSnapshotYs] = positions_.ys();
+	data[kSnapshotAlive] = positions_.alive();
+	header.bytes[kSnapshotXs] = header.ids * sizeof(float);
+	header.bytes[kSnapshotYs] = header.ids * sizeof(float);
+	header.bytes[kSnapshotAlive] = (header.ids + 63) / 64 * sizeof(uint64_t);
+	if (!grid_)
+	{
+		const FlatLayout<AoiId>& x_flat = x_tree_.Flat();
+		const FlatLayout<AoiId>& y_flat = y_tree_.Flat();
+		data[kSnapshotXValues] = x_flat.values();
+		data[kSnapshotXIds] = x_flat.ids();
+		data[kSnapshotYValues] = y_flat.values();
+		data[kSnapshotYIds] = y_flat.ids();
+		header.bytes[kSnapshotXValues] = x_flat.size() * sizeof(float);
+		header.bytes[kSnapshotXIds] = x_flat.size() * sizeof(AoiId);
+		header.bytes[kSnapshotYValues] = y_flat.size() * sizeof(float);
+		header.bytes[kSnapshotYIds] = y_flat.size() * sizeof(AoiId);
+	}
+
+	size_t offset = AlignUp(sizeof(header));
+	for (int s = 0; s < kSnapshotSections; ++s)
+	{
+		header.offset[s] = offset;
+		offset += AlignUp(header.bytes[s]);
+	}
+
+	std::string temp = std::string(path) + ".tmp";
+	FILE* file = fopen(temp.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool ok = WriteSection(file, &header, sizeof(header));
+	for (int s = 0; s < kSnapshotSections && ok; ++s)
+	{
+		ok = WriteSection(file, data[s], header.bytes[s]);
+	}
+	ok = fflush(file) == 0 && ok && fsync(fileno(file)) == 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(temp.c_str(), path) != 0)
+	{
+		unlink(temp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool Scene::Restore (const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader))
+	{
+		close(fd);
+		return false;
+	}
+
+	size_t size = st.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	// Every byte is read once from the start, let the kernel read ahead.
+	madvise(data, size, MADV_SEQUENTIAL);
+	bool ok = RestoreFrom(static_cast<const char*>(data), size);
+	munmap(data, size);
+	return ok;
+}
+
+// endregion public method
+
+// region private method
+
+bool Scene::RestoreFrom (const char* data, size_t size)
+{
+	SnapshotHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion
+	        || header.id_bytes != sizeof(AoiId) || header.ids > PositionStore::kMaxIds || header.players > header.ids)
+	{
+		return false;
+	}
+
+	// Every section in the file and aligned.
+	for (int s = 0; s < kSnapshotSections; ++s)
+	{
+		if (header.offset[s] % kSnapshotAlign != 0 || header.offset[s] > size
+		        || header.bytes[s] > size - header.offset[s])
+		{
+			return false;
+		}
+	}
+
+	// Lengths agree with the header.
+	uint64_t n = header.players;
+	uint64_t ids_len = header.ids;
+	bool has_trees = header.bytes[kSnapshotXValues] != 0 || n == 0;
+	if (header.bytes[kSnapshotXs] != ids_len * sizeof(float) || header.bytes[kSnapshotYs] != ids_len * sizeof(float)
+	        || header.bytes[kSnapshotAlive] != (ids_len + 63) / 64 * sizeof(uint64_t))
+	{
+		return false;
+	}
+	if (has_trees && (header.bytes[kSnapshotXValues] != n * sizeof(float) || header.bytes[kSnapshotXIds] != n * sizeof(AoiId)
+	                  || header.bytes[kSnapshotYValues] != n * sizeof(float) || header.bytes[kSnapshotYIds] != n * sizeof(AoiId)))
+	{
+		return false;
+	}
+
+	const float* xs = reinterpret_cast<const float*>(data + header.offset[kSnapshotXs]);
+	const float* ys = reinterpret_cast<const float*>(data + header.offset[kSnapshotYs]);
+	const uint64_t* alive = reinterpret_cast<const uint64_t*>(data + header.offset[kSnapshotAlive]);
+	const float* x_values = reinterpret_cast<const float*>(data + header.offset[kSnapshotXValues]);
+	const AoiId* x_ids = reinterpret_cast<const AoiId*>(data + header.offset[kSnapshotXIds]);
+	const float* y_values = reinterpret_cast<const float*>(data + header.offset[kSnapshotYValues]);
+	const AoiId* y_ids = reinterpret_cast<const AoiId*>(data + header.offset[kSnapshotYIds]);
+
+	// Check the players and the leaves before the scene is changed.
+	PositionStore positions;
+	positions.Assign(xs, ys, alive, ids_len);
+	if (positions.size() != n)
+	{
+		return false;
+	}
+	if (has_trees)
+	{
+		std::vector<uint64_t> seen((ids_len + 63) / 64);
+		if (!CheckLeaves(x_values, x_ids, n, xs, alive, ids_len, seen))
+		{
+			return false;
+		}
+		std::fill(seen.begin(), seen.end(), 0);
+		if (!CheckLeaves(y_values, y_ids, n, ys, alive, ids_len, seen))
+		{
+			return false;
+		}
+	}
+
+	positions_.Swap(positions);
+	tracker_.Reset();
+	others_valid_ = false;
+	view_.reset();
+	if (grid_)
+	{
+		grid_->Clear();
+		positions_.ForEach([&] (size_t id, float x_pos, float y_pos)
+		{
+			grid_->Insert(id, x_pos, y_pos);
+		});
+		return true;
+	}
+	if (has_trees)
+	{
+		x_tree_.LoadSorted(x_values, x_ids, n);
+		y_tree_.LoadSorted(y_values, y_ids, n);
+		return true;
+	}
+
+	// A snapshot of a grid scene, sort the players into the trees.
+	std::vector<AoiId> ids;
+	std::vector<float> x_coords, y_coords;
+	ids.reserve(n);
+	positions_.ForEach([&] (size_t id, float x_pos, float y_pos)
+	{
+		ids.push_back(id);
+		x_coords.push_back(x_pos);
+		y_coords.push_back(y_pos);
+	});
+	x_tree_.Load(x_coords.data(), ids.data(), n);
+	y_tree_.Load(y_coords.data(), ids.data(), n);
+	return true;
+}
+
+// endregion private method
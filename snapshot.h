@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////
+// @fileoverview Binary snapshot format of a scene.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace ysd_bes_aoi
+{
+
+	// "AOIS" read as a little endian word. A file written on a
+	// machine of the other byte order does not match.
+	const uint32_t kSnapshotMagic = 0x53494f41;
+
+	// Bumped on every change of the format. Older versions are
+	// not read, take a new snapshot after an upgrade.
+	const uint32_t kSnapshotVersion = 1;
+
+	// Sections start at multiples of this, so every array in a
+	// mapped file is aligned for its type.
+	const size_t kSnapshotAlign = 64;
+
+	// The arrays of a snapshot, in the order they are written.
+	enum SnapshotSection
+	{
+		// X/Y coordinates of the players as floats, indexed by id.
+		kSnapshotXs,
+		kSnapshotYs,
+
+		// Bitmap of the ids in use, as 64 bit words.
+		kSnapshotAlive,
+
+		// Leaves of the x tree in order: sorted x coordinates as
+		// floats and the ids in the same order. Empty for a grid.
+		kSnapshotXValues,
+		kSnapshotXIds,
+
+		// The same for the y tree.
+		kSnapshotYValues,
+		kSnapshotYIds,
+
+		kSnapshotSections,
+	};
+
+	///////////////////////////////////////////////////
+	// Start of a snapshot file. Sections are found by
+	// their offsets from the start of the file and hold
+	// no pointers, so Restore can check them where the
+	// file is mapped and load the trees from them in
+	// bulk, before the mapping is dropped.
+	///////////////////////////////////////////////////
+	struct SnapshotHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		// Bytes of a player id, 2 or 4.
+		uint32_t id_bytes;
+
+		uint32_t reserved;
+
+		// Number of players.
+		uint64_t players;
+
+		// Length of the coordinate arrays, all ids are less.
+		uint64_t ids;
+
+		// Offset and length in bytes of every section.
+		uint64_t offset[kSnapshotSections];
+		uint64_t bytes[kSnapshotSections];
+	};
+}
+
+#endif
@@ -0,0 +1,207 @@
+//////////////////////////////////////////////////
+// @fileoverview Remove and update of a segment tree by
+// the leaf of the id, checked against a plain map of
+// ids to values. Moves are sized so that every path of
+// Update is taken: in place, shifted and reinserted.
+// Usage: segment_tree_test, exits 1 on the first error.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "../segment_tree.h"
+
+using namespace ysd_bes_aoi;
+
+// Players in the scene, and the ids they are drawn from.
+static const uint32_t kPlayers = 2000;
+static const uint32_t kIds = 4000;
+
+// Width of the scene.
+static const float kWidth = 10000;
+
+// Random operations per test.
+static const int kSteps = 200000;
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			++failures; \
+			return; \
+		} \
+	} while (0)
+
+// Check a range search and count by walking the tree.
+template <typename Id>
+static void CheckRange (SegmentTree<Id>& tree, const std::map<Id, float>& model, float start, float end)
+{
+	std::vector<Id> expect;
+	for (auto& kv : model)
+	{
+		if (kv.second >= start && kv.second <= end)
+		{
+			expect.push_back(kv.first);
+		}
+	}
+
+	std::vector<Id> got;
+	tree.Search(start, end, got);
+	std::sort(got.begin(), got.end());
+	CHECK(got == expect, "search [%g, %g]: %zu ids, want %zu", start, end, got.size(), expect.size());
+	CHECK(tree.Count(start, end) == expect.size(), "count [%g, %g] is wrong", start, end);
+}
+
+// Check the leaves are sorted and hold every id once at its value.
+template <typename Id>
+static void CheckLeaves (SegmentTree<Id>& tree, const std::map<Id, float>& model)
+{
+	const FlatLayout<Id>& flat = tree.Flat();
+	CHECK(tree.size() == model.size(), "size %zu, want %zu", tree.size(), model.size());
+	CHECK(flat.size() == model.size(), "%zu leaves, want %zu", flat.size(), model.size());
+
+	std::vector<bool> seen(kIds);
+	for (size_t i = 0; i < flat.size(); ++i)
+	{
+		Id id = flat.ids()[i];
+		auto it = model.find(id);
+		CHECK(it != model.end(), "leaf of unknown id %u", unsigned(id));
+		CHECK(!seen[id], "id %u has two leaves", unsigned(id));
+		CHECK(flat.values()[i] == it->second, "id %u at %g, want %g", unsigned(id), flat.values()[i], it->second);
+		CHECK(i == 0 || flat.values()[i - 1] <= flat.values()[i], "leaves out of order at %zu", i);
+		seen[id] = true;
+	}
+
+	// An AVL tree is never higher than 1.44 log2(n + 2).
+	TreeStats stats = tree.stats();
+	CHECK(stats.height <= 1.45 * stats.ideal_height + 2, "height %u for %u leaves", stats.height, stats.leaves);
+	CHECK(stats.nodes == (model.empty() ? 0 : 2 * model.size() - 1), "%llu nodes for %zu leaves",
+	      (unsigned long long)stats.nodes, model.size());
+}
+
+template <typename Id>
+static void Run (const char* name, bool load)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> pos(0, kWidth);
+	std::uniform_int_distribution<uint32_t> pick(0, kIds - 1);
+
+	SegmentTree<Id> tree;
+	std::map<Id, float> model;
+
+	std::vector<float> values;
+	std::vector<Id> ids;
+	for (uint32_t id = 0; id < kPlayers; ++id)
+	{
+		// Some players share a value, as players standing still do.
+		float v = id % 10 == 0 ? 5000 : pos(rng);
+		values.push_back(v);
+		ids.push_back(Id(id));
+		model[Id(id)] = v;
+	}
+	if (load)
+	{
+		tree.Load(values.data(), ids.data(), values.size());
+	}
+	else
+	{
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			tree.Insert(ids[i], values[i]);
+		}
+	}
+	CheckLeaves(tree, model);
+
+	int before = failures;
+	for (int step = 0; step < kSteps && failures == before; ++step)
+	{
+		Id id = Id(pick(rng));
+		bool in = model.count(id) > 0;
+		uint32_t op = rng() % 100;
+		if (!in)
+		{
+			CHECK(!tree.Remove(id), "removed missing id %u", unsigned(id));
+			CHECK(!tree.Update(id, 1), "updated missing id %u", unsigned(id));
+			if (model.size() < kPlayers)
+			{
+				float v = pos(rng);
+				tree.Insert(id, v);
+				model[id] = v;
+			}
+		}
+		else if (op < 10 || model.size() > kPlayers)
+		{
+			CHECK(tree.Remove(id), "could not remove id %u", unsigned(id));
+			model.erase(id);
+		}
+		else
+		{
+			// Tiny moves stay between the neighbours, small ones pass a
+			// few leaves and big ones go anywhere in the scene.
+			float step_size = op < 40 ? 0.01f : op < 80 ? 10.0f : kWidth;
+			float v = model[id] + std::uniform_real_distribution<float>(-step_size, step_size)(rng);
+			v = std::min(std::max(v, 0.0f), kWidth);
+			CHECK(tree.Update(id, v), "could not update id %u", unsigned(id));
+			model[id] = v;
+		}
+
+		// Three searches walk the tree, the flat layout comes after four.
+		float a = pos(rng);
+		CheckRange(tree, model, a, a + 100);
+		CheckRange(tree, model, a, a);
+		if (step % 1000 == 0)
+		{
+			CheckRange(tree, model, -1, kWidth + 1);
+			CheckLeaves(tree, model);
+		}
+	}
+
+	// Remove all but one, then the last, then start over.
+	while (failures == before && model.size() > 1)
+	{
+		Id id = model.begin()->first;
+		CHECK(tree.Remove(id), "could not remove id %u", unsigned(id));
+		model.erase(id);
+		if (model.size() % 97 == 0)
+		{
+			CheckLeaves(tree, model);
+		}
+	}
+	if (failures == before)
+	{
+		CHECK(tree.Remove(model.begin()->first), "could not remove the last id");
+		model.clear();
+		CheckLeaves(tree, model);
+		tree.Insert(1, 2);
+		model[1] = 2;
+		CheckLeaves(tree, model);
+	}
+
+	TreeStats stats = tree.stats();
+	CHECK(stats.update_in_place > 0 && stats.update_shifted > 0 && stats.update_reinserted > 0,
+	      "update paths not all taken: %llu in place, %llu shifted, %llu reinserted",
+	      (unsigned long long)stats.update_in_place, (unsigned long long)stats.update_shifted,
+	      (unsigned long long)stats.update_reinserted);
+	printf("%-8s %s: %llu in place, %llu shifted, %llu reinserted, %s\n", name, load ? "load  " : "insert",
+	       (unsigned long long)stats.update_in_place, (unsigned long long)stats.update_shifted,
+	       (unsigned long long)stats.update_reinserted, failures == before ? "ok" : "FAILED");
+}
+
+int main ( )
+{
+	Run<uint16_t>("uint16_t", false);
+	Run<uint16_t>("uint16_t", true);
+	Run<uint32_t>("uint32_t", false);
+	Run<uint32_t>("uint32_t", true);
+	return failures == 0 ? 0 : 1;
+}
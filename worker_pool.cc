@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////
+// @fileoverview Fixed pool of worker threads.
+// @author ysd
+//////////////////////////////////////////////////
+
+#include "worker_pool.h"
+
+using namespace ysd_bes_aoi;
+
+// region public method
+
+WorkerPool::WorkerPool (size_t threads) :
+	next_ (0)
+{
+	threads_.reserve(threads);
+	for (size_t i = 0; i < threads; ++i)
+	{
+		threads_.emplace_back(&WorkerPool::Work, this);
+	}
+}
+
+WorkerPool::~WorkerPool ( )
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::ParallelFor (size_t n, const std::function<void (size_t)>& f)
+{
+	if (threads_.empty() || n < 2)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			f(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &f;
+		job_size_ = n;
+		next_.store(0, std::memory_order_relaxed);
+		busy_ = threads_.size();
+		++generation_;
+	}
+	wake_.notify_all();
+
+	Drain();
+
+	// The job must outlive every worker still calling it.
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] ( )
+	{
+		return busy_ == 0;
+	});
+	job_ = nullptr;
+}
+
+// endregion public method
+
+// region private method
+
+void WorkerPool::Work ( )
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [&] ( )
+			{
+				return stop_ || generation_ != seen;
+			});
+			if (stop_)
+			{
+				return;
+			}
+			seen = generation_;
+		}
+
+		Drain();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--busy_ == 0)
+		{
+			done_.notify_one();
+		}
+	}
+}
+
+void WorkerPool::Drain ( )
+{
+	for (size_t i = next_.fetch_add(1); i < job_size_; i = next_.fetch_add(1))
+	{
+		(*job_)(i);
+	}
+}
+
+// endregion private method
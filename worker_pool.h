@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////
+// @fileoverview Fixed pool of worker threads.
+// @author ysd
+//////////////////////////////////////////////////
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ysd_bes_aoi
+{
+
+	///////////////////////////////////////////////////
+	// Threads started once and kept waiting for work,
+	// so a parallel loop only pays a wake up instead
+	// of starting threads. The calling thread takes
+	// part in every loop too. Loops are run one at a
+	// time, by one calling thread.
+	///////////////////////////////////////////////////
+	class WorkerPool final
+	{
+	public:
+
+		// @param[in]	threads 	Number of worker threads besides the
+		//							calling one. 0 runs loops on the
+		//							calling thread only.
+		explicit WorkerPool (size_t threads);
+
+		// Stop and join the workers.
+		~WorkerPool ( );
+
+		WorkerPool (const WorkerPool&) = delete;
+		WorkerPool& operator= (const WorkerPool&) = delete;
+
+		// Call f(i) for every i in [0, n), spread over the workers
+		// and the calling thread. Returns when all calls are done.
+		void ParallelFor (size_t n, const std::function<void (size_t)>& f);
+
+		// Number of worker threads besides the calling one.
+		size_t threads ( ) const
+		{
+			return threads_.size();
+		}
+
+	private:
+
+		// Loop of a worker thread.
+		void Work ( );
+
+		// Take indexes of the current loop until none is left.
+		void Drain ( );
+
+		std::vector<std::thread> threads_;
+
+		std::mutex mutex_;
+
+		// Signaled when a loop starts or the pool stops.
+		std::condition_variable wake_;
+
+		// Signaled when the last worker leaves a loop.
+		std::condition_variable done_;
+
+		// The current loop, and the next index of it to take.
+		const std::function<void (size_t)>* job_ = nullptr;
+		size_t job_size_ = 0;
+		std::atomic<size_t> next_;
+
+		// Counts up for every loop, so a worker joins each one once.
+		uint64_t generation_ = 0;
+
+		// Workers still in the current loop.
+		size_t busy_ = 0;
+
+		bool stop_ = false;
+	};
+}
+
+#endif